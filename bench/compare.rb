@@ -0,0 +1,32 @@
+# Compare two result files of bench/lmdb_bench.rb
+#
+#   ruby bench/compare.rb base.json new.json
+#
+# Changes within two standard deviations of either run are not flagged.
+
+require 'json'
+
+abort "usage: #{$0} base.json new.json" unless ARGV.size == 2
+base, new = ARGV.map { |file| JSON.parse(File.read(file)) }
+
+index = lambda do |run|
+  run['results'].each_with_object({}) { |r, h| h[[r['group'], r['name']]] = r }
+end
+base_results, new_results = index[base], index[new]
+
+puts "#{base['version']} (#{base['lmdb']}) -> #{new['version']} (#{new['lmdb']})"
+puts '%-10s %-24s %14s %14s %9s' % %w(group case base new change)
+regressions = 0
+(base_results.keys | new_results.keys).each do |group, name|
+  a, b = base_results[[group, name]], new_results[[group, name]]
+  unless a && b
+    puts '%-10s %-24s %14s %14s' % [group, name, a ? '%.1f' % a['ips'] : '-', b ? '%.1f' % b['ips'] : '-']
+    next
+  end
+  change = b['ips'] / a['ips'] - 1
+  noise = 2 * [a['stddev'] / a['ips'], b['stddev'] / b['ips']].max
+  flag = change.abs <= noise ? '' : change < 0 ? ' slower' : ' faster'
+  regressions += 1 if flag == ' slower'
+  puts '%-10s %-24s %14.1f %14.1f %+8.1f%%%s' % [group, name, a['ips'], b['ips'], change * 100, flag]
+end
+exit(regressions > 0 ? 1 : 0)
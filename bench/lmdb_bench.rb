@@ -0,0 +1,194 @@
+# Microbenchmarks of the binding and the engine underneath it.
+#
+#   rake bench                         # all groups, results in bench/results
+#   BENCH_FILTER=get,cursor rake bench # only some groups
+#   BENCH_OUT=base.json rake bench     # choose the output file
+#   rake bench:compare[base.json,bench/results/....json]
+#
+# BENCH_KEYS sets the number of records (100_000), BENCH_TIME and
+# BENCH_WARMUP the seconds spent measuring and warming up each case.
+
+require 'lmdb'
+require 'benchmark/ips'
+require 'fileutils'
+require 'json'
+require 'tmpdir'
+
+module LMDB
+  class Bench
+    GROUPS = %w(get put delete cursor dupsort txn values threads)
+
+    def initialize
+      @keys = Integer(ENV['BENCH_KEYS'] || 100_000)
+      @time = Float(ENV['BENCH_TIME'] || 2)
+      @warmup = Float(ENV['BENCH_WARMUP'] || 1)
+      @groups = ENV['BENCH_FILTER'] ? ENV['BENCH_FILTER'].split(',') : GROUPS
+      @results = []
+    end
+
+    def run
+      Dir.mktmpdir('lmdb-bench') do |dir|
+        @env = LMDB.new(dir, :mapsize => 1 << 32, :nosync => true)
+        @db = @env.database
+        @env.transaction { key_range.each { |i| @db.put(key(i), 'x' * 100) } }
+        @groups.each { |group| send("bench_#{group}") }
+        @env.close
+      end
+      write
+    end
+
+    private
+
+    def key(i)
+      '%016d' % i
+    end
+
+    def key_range
+      0...@keys
+    end
+
+    def random_key
+      key(rand(@keys))
+    end
+
+    def bench(group)
+      report = Benchmark.ips do |x|
+        x.config(:time => @time, :warmup => @warmup)
+        yield x
+      end
+      report.entries.each do |entry|
+        @results << {
+          :group => group,
+          :name => entry.label,
+          :ips => entry.ips,
+          :stddev => entry.ips_sd,
+          :iterations => entry.iterations,
+        }
+      end
+    end
+
+    # Run +times+ iterations inside read-only transactions of at most
+    # +batch+ operations each
+    def in_read_txns(times, batch = 1000)
+      done = 0
+      while done < times
+        n = [times - done, batch].min
+        @env.transaction(true) { n.times { yield } }
+        done += n
+      end
+    end
+
+    def bench_get
+      bench('get') do |x|
+        x.report('hit') { |times| in_read_txns(times) { @db.get(random_key) } }
+        x.report('miss') { |times| in_read_txns(times) { @db.get('missing') } }
+      end
+    end
+
+    def bench_put
+      bench('put') do |x|
+        x.report('overwrite') do |times|
+          @env.transaction { times.times { @db.put(random_key, 'y' * 100) } }
+        end
+        x.report('append') do |times|
+          @env.transaction do |txn|
+            append = @env.database('append', :create => true)
+            times.times { |i| append.put(key(i), 'y' * 100, :append => true) }
+            txn.abort
+          end
+        end
+      end
+    end
+
+    def bench_delete
+      bench('delete') do |x|
+        x.report('delete') do |times|
+          done = 0
+          while done < times
+            n = [times - done, @keys].min
+            @env.transaction { |txn| n.times { |i| @db.delete(key(i)) }; txn.abort }
+            done += n
+          end
+        end
+      end
+    end
+
+    def bench_cursor
+      bench('cursor') do |x|
+        x.report("scan #{@keys}") do
+          @db.cursor { |c| nil while c.next }
+        end
+        x.report("each #{@keys}") do
+          @db.each { |kv| kv }
+        end
+      end
+    end
+
+    def bench_dupsort
+      dupdb = nil
+      @env.transaction do
+        dupdb = @env.database('dupsort', :create => true, :dupsort => true)
+        (@keys / 100).times { |i| 100.times { |j| dupdb.put(key(i), key(j)) } }
+      end
+      bench('dupsort') do |x|
+        x.report("traverse #{@keys / 100}x100") do
+          dupdb.cursor { |c| nil while c.next }
+        end
+        x.report('next_nodup') do
+          dupdb.cursor { |c| nil while c.next(true) }
+        end
+      end
+    end
+
+    def bench_txn
+      bench('txn') do |x|
+        x.report('implicit get') { @db.get(random_key) }
+        x.report('explicit get') { |times| in_read_txns(times) { @db.get(random_key) } }
+        x.report('implicit put') { @db.put(random_key, 'z' * 100) }
+        x.report('read-only txn') { @env.transaction(true) {} }
+      end
+    end
+
+    def bench_values
+      small, large = 'v' * 16, 'v' * 16384
+      @env.transaction do
+        @db.put('small', small)
+        @db.put('large', large)
+      end
+      bench('values') do |x|
+        x.report('get 16B') { |times| in_read_txns(times) { @db.get('small') } }
+        x.report('get 16KB') { |times| in_read_txns(times) { @db.get('large') } }
+        x.report('put 16B') { |times| @env.transaction { times.times { @db.put(random_key, small) } } }
+        x.report('put 16KB') { |times| @env.transaction { times.times { @db.put(random_key, large) } } }
+      end
+    end
+
+    def bench_threads
+      bench('threads') do |x|
+        [1, 4, 16].each do |threads|
+          x.report("get #{threads} threads") do |times|
+            (0...threads).map do |t|
+              Thread.new { in_read_txns(times / threads + (t < times % threads ? 1 : 0)) { @db.get(random_key) } }
+            end.each(&:join)
+          end
+        end
+      end
+    end
+
+    def write
+      out = ENV['BENCH_OUT'] || File.join(File.dirname(__FILE__), 'results',
+        "#{LMDB::VERSION}-#{`git rev-parse --short HEAD 2>/dev/null`.chomp}-#{Time.now.strftime('%Y%m%d%H%M%S')}.json")
+      FileUtils.mkpath(File.dirname(out))
+      File.write(out, JSON.pretty_generate(
+        :version => LMDB::VERSION,
+        :lmdb => LMDB::LIB_VERSION,
+        :ruby => RUBY_DESCRIPTION,
+        :time => Time.now.utc.to_s,
+        :keys => @keys,
+        :results => @results))
+      puts "Results written to #{out}"
+    end
+  end
+end
+
+LMDB::Bench.new.run
@@ -0,0 +1,935 @@
+/* Microbenchmarks of liblmdb internals, without Ruby in the loop.
+ *
+ * The bundled sources are included directly so that static functions
+ * like mdb_node_search() can be called. Results are printed and can be
+ * written as JSON in the format of bench/lmdb_bench.rb, so runs can be
+ * compared with bench/compare.rb.
+ *
+ *	mdb_bench [-t seconds] [-o results.json] [-s] [group...]
+ *
+ * -s syncs commits, otherwise the environment uses MDB_NOSYNC.
+ */
+#define _GNU_SOURCE
+#include "../../ext/lmdb_ext/liblmdb/mdb.c"
+#include "../../ext/lmdb_ext/liblmdb/midl.c"
+
+#include <time.h>
+#include <math.h>
+
+#define E(expr) do { \
+	int rc_ = (expr); \
+	if (rc_) { \
+		fprintf(stderr, "%s:%d: %s: %s\n", __FILE__, __LINE__, #expr, mdb_strerror(rc_)); \
+		exit(1); \
+	} \
+} while (0)
+
+	/** Number of timed runs of each benchmark */
+#define SAMPLES	5
+	/** Records in the databases that are searched */
+#define RECORDS	100000
+	/** Records put per write transaction */
+#define PUT_BATCH	50000
+
+typedef struct result {
+	const char *group;
+	char name[64];
+	double ips;
+	double stddev;
+	unsigned long iterations;
+} result;
+
+	/** A benchmark runs n iterations and returns the seconds spent in
+	 * the part that is measured.
+	 */
+typedef double (bench_func)(void *ctx, unsigned long n);
+
+static result results[64];
+static int nresults;
+static double min_time = 1;
+static char **groups;
+static int ngroups;
+static unsigned int env_flags = MDB_NOSYNC;
+static char env_dir[] = "/tmp/mdb_bench.XXXXXX";
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+	/** Deterministic random numbers, so runs are comparable */
+static uint64_t
+next_rand(uint64_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static int
+selected(const char *group)
+{
+	int i;
+	if (!ngroups)
+		return 1;
+	for (i = 0; i < ngroups; i++)
+		if (!strcmp(groups[i], group))
+			return 1;
+	return 0;
+}
+
+	/** Run a benchmark, doubling the iterations until a sample takes
+	 * long enough, then take #SAMPLES samples.
+	 */
+static void
+bench(const char *group, const char *name, bench_func *fn, void *ctx)
+{
+	result *r = &results[nresults++];
+	unsigned long n = 1;
+	double t, ips[SAMPLES], sum = 0, var = 0;
+	int i;
+
+	while ((t = fn(ctx, n)) < min_time / SAMPLES && n < 1UL << 40)
+		n = t > 0 && t * 4 > min_time / SAMPLES ? n * (min_time / SAMPLES / t) + 1 : n * 4;
+	for (i = 0; i < SAMPLES; i++) {
+		ips[i] = n / fn(ctx, n);
+		sum += ips[i];
+	}
+	r->ips = sum / SAMPLES;
+	for (i = 0; i < SAMPLES; i++)
+		var += (ips[i] - r->ips) * (ips[i] - r->ips);
+	r->stddev = sqrt(var / SAMPLES);
+	r->group = group;
+	r->iterations = n * SAMPLES;
+	snprintf(r->name, sizeof(r->name), "%s", name);
+	printf("%-10s %-28s %14.1f ops/s %6.1f%% %10.1f ns\n", group, name,
+		r->ips, r->stddev * 100 / r->ips, 1e9 / r->ips);
+	fflush(stdout);
+}
+
+	/** Open an environment, with the default maxdirty and writers where
+	 * \b maxdirty or \b writers is 0
+	 */
+static MDB_env *
+open_env(unsigned int maxdirty, unsigned int writers)
+{
+	MDB_env *env;
+	E(mdb_env_create(&env));
+	E(mdb_env_set_mapsize(env, (size_t)1 << 34));
+	if (maxdirty)
+		E(mdb_env_set_maxdirty(env, maxdirty));
+	if (writers)
+		E(mdb_env_set_writers(env, writers));
+	E(mdb_env_open(env, env_dir, env_flags, 0644));
+	return env;
+}
+
+static void
+close_env(MDB_env *env)
+{
+	char path[sizeof(env_dir) + 16];
+	mdb_env_close(env);
+	snprintf(path, sizeof(path), "%s/data.mdb", env_dir);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/lock.mdb", env_dir);
+	unlink(path);
+}
+
+#define KEY_SIZE	16
+
+static void
+make_key(char *buf, uint64_t i)
+{
+	char tmp[KEY_SIZE + 1];
+	snprintf(tmp, sizeof(tmp), "%016" PRIu64, i);
+	memcpy(buf, tmp, KEY_SIZE);
+}
+
+static void
+fill(MDB_env *env, unsigned long records, size_t vsize)
+{
+	MDB_txn *txn;
+	MDB_dbi dbi;
+	MDB_val key, data;
+	char kbuf[KEY_SIZE], *vbuf = calloc(1, vsize);
+	unsigned long i;
+
+	E(mdb_txn_begin(env, NULL, 0, &txn));
+	E(mdb_dbi_open(txn, NULL, 0, &dbi));
+	key.mv_size = KEY_SIZE;
+	key.mv_data = kbuf;
+	data.mv_size = vsize;
+	data.mv_data = vbuf;
+	for (i = 0; i < records; i++) {
+		make_key(kbuf, i);
+		E(mdb_put(txn, dbi, &key, &data, MDB_APPEND));
+	}
+	E(mdb_txn_commit(txn));
+	free(vbuf);
+}
+
+	/* mdb_node_search */
+
+typedef struct search_ctx {
+	MDB_cursor *mc;
+	MDB_val keys[RECORDS];
+	int nkeys;
+	int level;		/**< cursor level to search, 0 is the root */
+} search_ctx;
+
+static double
+bench_node_search(void *arg, unsigned long n)
+{
+	search_ctx *ctx = arg;
+	MDB_cursor *mc = ctx->mc;
+	unsigned short top = mc->mc_top;
+	unsigned long i;
+	int exact, found = 0;
+	double t = now();
+
+	mc->mc_top = ctx->level;
+	for (i = 0; i < n; i++)
+		found += mdb_node_search(mc, &ctx->keys[i % ctx->nkeys], &exact) != NULL;
+	t = now() - t;
+	mc->mc_top = top;
+	if (found < 0)
+		abort();
+	return t;
+}
+
+static void
+run_node_search(void)
+{
+	static search_ctx ctx;
+	static char kbufs[RECORDS][KEY_SIZE];
+	MDB_env *env = open_env(0, 0);
+	MDB_txn *txn;
+	MDB_dbi dbi;
+	MDB_val key, data;
+	uint64_t seed = 1;
+	int i;
+
+	fill(env, RECORDS, 32);
+	E(mdb_txn_begin(env, NULL, MDB_RDONLY, &txn));
+	E(mdb_dbi_open(txn, NULL, 0, &dbi));
+	E(mdb_cursor_open(txn, dbi, &ctx.mc));
+	ctx.nkeys = RECORDS;
+	for (i = 0; i < RECORDS; i++) {
+		make_key(kbufs[i], next_rand(&seed) % RECORDS);
+		ctx.keys[i].mv_size = KEY_SIZE;
+		ctx.keys[i].mv_data = kbufs[i];
+	}
+	/* Position on a leaf in the middle, the keys mostly fall outside it
+	 * which costs a full binary search like a miss.
+	 */
+	make_key(kbufs[0], RECORDS / 2);
+	key = ctx.keys[0];
+	E(mdb_cursor_get(ctx.mc, &key, &data, MDB_SET));
+
+	ctx.level = ctx.mc->mc_top;
+	bench("search", "node_search leaf", bench_node_search, &ctx);
+	ctx.level = 0;
+	bench("search", "node_search root branch", bench_node_search, &ctx);
+
+	mdb_cursor_close(ctx.mc);
+	mdb_txn_abort(txn);
+	close_env(env);
+}
+
+	/* mdb_cursor_put */
+
+typedef struct put_ctx {
+	MDB_env *env;
+	unsigned int flags;
+	int random;
+	int splits;		/**< only time puts that split a page */
+	size_t vsize;
+} put_ctx;
+
+static double
+bench_cursor_put(void *arg, unsigned long n)
+{
+	put_ctx *ctx = arg;
+	MDB_txn *txn;
+	MDB_cursor *mc;
+	MDB_dbi dbi;
+	MDB_val key, data;
+	char kbuf[KEY_SIZE], vbuf[256] = {0};
+	uint64_t seed = 42;
+	unsigned long i, done = 0, splits;
+	double t = 0, t0, t1;
+
+	key.mv_size = KEY_SIZE;
+	key.mv_data = kbuf;
+	/* Puts are counted, not timed, until enough splits were seen */
+	while (done < n) {
+		E(mdb_txn_begin(ctx->env, NULL, 0, &txn));
+		E(mdb_dbi_open(txn, NULL, 0, &dbi));
+		E(mdb_cursor_open(txn, dbi, &mc));
+		t0 = now();
+		for (i = 0; i < PUT_BATCH && done < n; i++) {
+			make_key(kbuf, ctx->random ? next_rand(&seed) : i);
+			data.mv_size = ctx->vsize;
+			data.mv_data = vbuf;
+			if (ctx->splits) {
+				splits = ctx->env->me_metrics.mx_splits;
+				t1 = now();
+				E(mdb_cursor_put(mc, &key, &data, ctx->flags));
+				if (ctx->env->me_metrics.mx_splits != splits) {
+					t += now() - t1;
+					done++;
+				}
+			} else {
+				E(mdb_cursor_put(mc, &key, &data, ctx->flags));
+				done++;
+			}
+		}
+		if (!ctx->splits)
+			t += now() - t0;
+		mdb_cursor_close(mc);
+		mdb_txn_abort(txn);
+	}
+	return t;
+}
+
+static void
+run_cursor_put(void)
+{
+	put_ctx ctx = { open_env(0, 0), 0, 0, 0, 32 };
+
+	bench("put", "cursor_put sequential", bench_cursor_put, &ctx);
+	ctx.flags = MDB_APPEND;
+	bench("put", "cursor_put APPEND", bench_cursor_put, &ctx);
+	ctx.flags = 0;
+	ctx.random = 1;
+	bench("put", "cursor_put random", bench_cursor_put, &ctx);
+	ctx.vsize = 200;
+	bench("put", "cursor_put random 200B", bench_cursor_put, &ctx);
+	close_env(ctx.env);
+}
+
+	/* mdb_page_split, timed as the puts that split a page */
+
+static void
+run_page_split(void)
+{
+	put_ctx ctx = { open_env(0, 0), 0, 1, 1, 32 };
+
+	bench("split", "page_split random", bench_cursor_put, &ctx);
+	ctx.random = 0;
+	bench("split", "page_split sequential", bench_cursor_put, &ctx);
+	ctx.flags = MDB_APPEND;
+	bench("split", "page_split APPEND", bench_cursor_put, &ctx);
+	close_env(ctx.env);
+}
+
+	/* mdb_txn_commit */
+
+	/** Overflow pages written by a batch transaction, more than the
+	 * default maxdirty of 131071
+	 */
+#define BATCH_PAGES	160000
+
+typedef struct commit_ctx {
+	MDB_env *env;
+	unsigned int pages;
+	int batch;		/**< time the puts as well as the commit */
+} commit_ctx;
+
+static double
+bench_commit(void *arg, unsigned long n)
+{
+	commit_ctx *ctx = arg;
+	MDB_txn *txn;
+	MDB_dbi dbi;
+	MDB_val key, data;
+	char kbuf[KEY_SIZE];
+	static char vbuf[3000];
+	unsigned long i;
+	unsigned int j;
+	double t = 0, t0;
+
+	key.mv_size = KEY_SIZE;
+	key.mv_data = kbuf;
+	data.mv_size = sizeof(vbuf);
+	data.mv_data = vbuf;
+	for (i = 0; i < n; i++) {
+		/* Each value takes an overflow page of its own */
+		E(mdb_txn_begin(ctx->env, NULL, 0, &txn));
+		E(mdb_dbi_open(txn, NULL, 0, &dbi));
+		t0 = now();
+		for (j = 0; j < ctx->pages; j++) {
+			make_key(kbuf, j);
+			E(mdb_put(txn, dbi, &key, &data, 0));
+		}
+		if (!ctx->batch)
+			t0 = now();
+		E(mdb_txn_commit(txn));
+		t += now() - t0;
+	}
+	return t;
+}
+
+	/** Time the commit of a transaction dropping \b pages records of
+	 * one overflow page each, which saves their pages to the freeDB.
+	 */
+static double
+bench_delete_commit(void *arg, unsigned long n)
+{
+	commit_ctx *ctx = arg;
+	MDB_txn *txn;
+	MDB_dbi dbi;
+	unsigned long i;
+	double t = 0, t0;
+
+	for (i = 0; i < n; i++) {
+		fill(ctx->env, ctx->pages, 3000);
+		E(mdb_txn_begin(ctx->env, NULL, 0, &txn));
+		E(mdb_dbi_open(txn, NULL, 0, &dbi));
+		E(mdb_drop(txn, dbi, 0));
+		t0 = now();
+		E(mdb_txn_commit(txn));
+		t += now() - t0;
+	}
+	return t;
+}
+
+static void
+run_commit(void)
+{
+	static const unsigned int sizes[] = { 16, 256, 4096, 32768 };
+	static const struct {
+		unsigned int flag;
+		unsigned int writers;
+		unsigned int sizes;	/**< how many of \b sizes to run */
+		const char *name;
+	} modes[] = {
+		{ MDB_SINGLESYNC, 0, 2, "singlesync" },
+		{ MDB_IOURING, 0, 4, "iouring" },
+		{ 0, 4, 4, "4 writers" },
+	};
+	commit_ctx ctx = { NULL, 0, 0 };
+	MDB_txn *txn;
+	MDB_dbi dbi;
+	char name[64];
+	unsigned int i, m;
+
+	ctx.env = open_env(0, 0);
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		ctx.pages = sizes[i];
+		snprintf(name, sizeof(name), "txn_commit %u dirty", sizes[i]);
+		bench("commit", name, bench_commit, &ctx);
+	}
+	ctx.pages = 32768;
+	E(mdb_txn_begin(ctx.env, NULL, 0, &txn));
+	E(mdb_dbi_open(txn, NULL, 0, &dbi));
+	E(mdb_drop(txn, dbi, 0));
+	E(mdb_txn_commit(txn));
+	bench("commit", "txn_commit 32768 deleted", bench_delete_commit, &ctx);
+	E(mdb_env_set_flags(ctx.env, MDB_FREERANGES, 1));
+	bench("commit", "txn_commit 32768 deleted, ranges", bench_delete_commit, &ctx);
+	close_env(ctx.env);
+
+	/* The same commits with other flush modes, each from a fresh
+	 * environment as above. One sync per commit only differs with -s.
+	 */
+	for (m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+		ctx.env = open_env(0, modes[m].writers);
+		if (modes[m].flag)
+			E(mdb_env_set_flags(ctx.env, modes[m].flag, 1));
+		for (i = 0; i < modes[m].sizes; i++) {
+			ctx.pages = sizes[i];
+			snprintf(name, sizeof(name), "txn_commit %u dirty, %s",
+				sizes[i], modes[m].name);
+			bench("commit", name, bench_commit, &ctx);
+		}
+		close_env(ctx.env);
+	}
+
+	/* A batch larger than the dirty list, spilled or kept in memory */
+	ctx.pages = BATCH_PAGES;
+	ctx.batch = 1;
+	ctx.env = open_env(0, 0);
+	bench("commit", "batch 160000 dirty, spilled", bench_commit, &ctx);
+	close_env(ctx.env);
+	ctx.env = open_env(BATCH_PAGES * 2, 0);
+	bench("commit", "batch 160000 dirty, maxdirty", bench_commit, &ctx);
+	close_env(ctx.env);
+}
+
+	/* mdb_page_alloc of overflow page runs from a fragmented freelist */
+
+	/** Multi-page allocations per transaction */
+#define ALLOC_BATCH	32
+
+typedef struct alloc_ctx {
+	MDB_env *env;
+	MDB_IDL free;	/**< me_pghead to start each transaction with */
+	int num;		/**< pages per allocation */
+} alloc_ctx;
+
+static double
+bench_page_alloc(void *arg, unsigned long n)
+{
+	alloc_ctx *ctx = arg;
+	MDB_txn *txn;
+	MDB_cursor *mc;
+	MDB_dbi dbi;
+	MDB_page *mp;
+	unsigned long i, done = 0;
+	double t = 0, t0;
+
+	while (done < n) {
+		E(mdb_txn_begin(ctx->env, NULL, 0, &txn));
+		E(mdb_dbi_open(txn, NULL, 0, &dbi));
+		E(mdb_cursor_open(txn, dbi, &mc));
+		ctx->env->me_pghead = mdb_midl_alloc(ctx->free[0]);
+		memcpy(ctx->env->me_pghead, ctx->free, (ctx->free[0] + 1) * sizeof(MDB_ID));
+		t0 = now();
+		for (i = 0; i < ALLOC_BATCH && done < n; i++, done++)
+			E(mdb_page_alloc(mc, ctx->num, &mp));
+		t += now() - t0;
+		mdb_cursor_close(mc);
+		mdb_txn_abort(txn);
+	}
+	return t;
+}
+
+static void
+run_page_alloc(void)
+{
+	static const unsigned int sizes[] = { 1024, 65536 };
+	alloc_ctx ctx;
+	char name[64];
+	uint64_t seed = 5;
+	unsigned int i, j, k;
+	pgno_t pgno;
+
+	ctx.env = open_env(0, 0);
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		/* A run for each allocation at the far end from where the
+		 * scan starts, then half the pages below them free at random.
+		 */
+		ctx.free = mdb_midl_alloc(sizes[i] + ALLOC_BATCH * 64);
+		ctx.free[0] = 0;
+		pgno = 2 + sizes[i] * 2 + ALLOC_BATCH * 65;
+		for (j = ALLOC_BATCH; j; j--, pgno--)
+			for (k = 64; k; k--)
+				ctx.free[++ctx.free[0]] = pgno--;
+		for (; pgno > 2 && ctx.free[0] < sizes[i] + ALLOC_BATCH * 64; pgno--)
+			if (next_rand(&seed) & 1)
+				ctx.free[++ctx.free[0]] = pgno;
+		for (ctx.num = 4; ctx.num <= 64; ctx.num *= 4) {
+			snprintf(name, sizeof(name), "page_alloc %d pages, %u free", ctx.num, (unsigned int)ctx.free[0]);
+			bench("alloc", name, bench_page_alloc, &ctx);
+		}
+		mdb_midl_free(ctx.free);
+	}
+	close_env(ctx.env);
+}
+
+	/* mdb_page_alloc while many readers pin the freeDB records */
+
+	/** Read-only transactions holding a reader slot each */
+#define PINNED_READERS	4000
+	/** Page allocations per write transaction */
+#define PINNED_BATCH	1024
+
+static double
+bench_pinned_alloc(void *arg, unsigned long n)
+{
+	MDB_env *env = arg;
+	MDB_txn *txn;
+	MDB_cursor *mc;
+	MDB_dbi dbi;
+	MDB_page *mp;
+	unsigned long i, done = 0;
+	double t = 0, t0;
+
+	while (done < n) {
+		E(mdb_txn_begin(env, NULL, 0, &txn));
+		E(mdb_dbi_open(txn, NULL, 0, &dbi));
+		E(mdb_cursor_open(txn, dbi, &mc));
+		t0 = now();
+		for (i = 0; i < PINNED_BATCH && done < n; i++, done++)
+			E(mdb_page_alloc(mc, 1, &mp));
+		t += now() - t0;
+		mdb_cursor_close(mc);
+		mdb_txn_abort(txn);
+	}
+	return t;
+}
+
+static void
+run_pinned_alloc(void)
+{
+	MDB_env *env;
+	MDB_txn *txn, **readers = malloc(PINNED_READERS * sizeof(MDB_txn *));
+	MDB_dbi dbi;
+	char name[64];
+	int i;
+
+	E(mdb_env_create(&env));
+	E(mdb_env_set_mapsize(env, (size_t)1 << 34));
+	E(mdb_env_set_maxreaders(env, PINNED_READERS));
+	E(mdb_env_open(env, env_dir, env_flags | MDB_NOTLS, 0644));
+	fill(env, RECORDS, 100);
+	for (i = 0; i < PINNED_READERS; i++)
+		E(mdb_txn_begin(env, NULL, MDB_RDONLY, &readers[i]));
+	/* Free pages the readers still see, so each allocation finds
+	 * the freeDB record too recent and extends the file.
+	 */
+	E(mdb_txn_begin(env, NULL, 0, &txn));
+	E(mdb_dbi_open(txn, NULL, 0, &dbi));
+	E(mdb_drop(txn, dbi, 0));
+	E(mdb_txn_commit(txn));
+	snprintf(name, sizeof(name), "page_alloc %d readers", PINNED_READERS);
+	bench("alloc", name, bench_pinned_alloc, env);
+	for (i = 0; i < PINNED_READERS; i++)
+		mdb_txn_abort(readers[i]);
+	free(readers);
+	close_env(env);
+}
+
+	/* Lookups of dirty pages in a large write transaction */
+
+typedef struct dirty_ctx {
+	MDB_txn *txn;
+	pgno_t *pgnos;	/**< dirty pages to look up, in random order */
+	unsigned int npgnos;
+	int hash;		/**< through mdb_page_get, else mdb_mid2l_search */
+} dirty_ctx;
+
+static double
+bench_dirty_lookup(void *arg, unsigned long n)
+{
+	dirty_ctx *ctx = arg;
+	MDB_ID2L dl = ctx->txn->mt_u.dirty_list;
+	MDB_page *mp;
+	unsigned long i;
+	unsigned int x;
+	double t0 = now();
+
+	for (i = 0; i < n; i++) {
+		pgno_t pgno = ctx->pgnos[i % ctx->npgnos];
+		if (ctx->hash) {
+			E(mdb_page_get(ctx->txn, pgno, &mp, NULL));
+		} else {
+			x = mdb_mid2l_search(dl, pgno);
+			if (x > dl[0].mid || dl[x].mid != pgno)
+				exit(1);
+			mp = dl[x].mptr;
+		}
+		if (!mp)
+			exit(1);
+	}
+	return now() - t0;
+}
+
+static void
+run_dirty_lookup(void)
+{
+	static const unsigned int sizes[] = { 256, 1024, 4096, 65536 };
+	dirty_ctx ctx;
+	MDB_env *env = open_env(0, 0);
+	MDB_dbi dbi;
+	MDB_val key, data;
+	MDB_ID2L dl;
+	char kbuf[KEY_SIZE], name[64];
+	static char vbuf[3000];
+	uint64_t seed = 3;
+	unsigned int i, j, k;
+
+	key.mv_size = KEY_SIZE;
+	key.mv_data = kbuf;
+	data.mv_size = sizeof(vbuf);
+	data.mv_data = vbuf;
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		/* Each value takes an overflow page of its own */
+		E(mdb_txn_begin(env, NULL, 0, &ctx.txn));
+		E(mdb_dbi_open(ctx.txn, NULL, 0, &dbi));
+		for (j = 0; j < sizes[i]; j++) {
+			make_key(kbuf, j);
+			E(mdb_put(ctx.txn, dbi, &key, &data, 0));
+		}
+		dl = ctx.txn->mt_u.dirty_list;
+		ctx.npgnos = dl[0].mid;
+		ctx.pgnos = malloc(ctx.npgnos * sizeof(pgno_t));
+		for (j = 0; j < ctx.npgnos; j++)
+			ctx.pgnos[j] = dl[j + 1].mid;
+		for (j = ctx.npgnos; j > 1; j--) {
+			pgno_t tmp = ctx.pgnos[j - 1];
+			k = next_rand(&seed) % j;
+			ctx.pgnos[j - 1] = ctx.pgnos[k];
+			ctx.pgnos[k] = tmp;
+		}
+		ctx.hash = 1;
+		snprintf(name, sizeof(name), "page_get %u dirty", ctx.npgnos);
+		bench("dirty", name, bench_dirty_lookup, &ctx);
+		ctx.hash = 0;
+		snprintf(name, sizeof(name), "mid2l_search %u dirty", ctx.npgnos);
+		bench("dirty", name, bench_dirty_lookup, &ctx);
+		free(ctx.pgnos);
+		mdb_txn_abort(ctx.txn);
+	}
+	close_env(env);
+}
+
+	/* mdb_midl_sort and mdb_midl_xmerge, against the quicksort and
+	 * the element by element merge they replace for long lists
+	 */
+
+/* Merge lists to rotate through, up to 4M IDs in all, so that the
+ * branch predictor cannot learn the order of a short merge
+ */
+#define MERGES	256
+
+typedef struct midl_ctx {
+	MDB_IDL src;
+	MDB_IDL merge[MERGES];
+	unsigned int merges;
+	MDB_IDL work;
+	MDB_ID2L src2;
+	MDB_ID2L work2;
+	void (*sort)(MDB_IDL);
+	void (*xmerge)(MDB_IDL, MDB_IDL);
+} midl_ctx;
+
+/* mdb_midl_xmerge without galloping */
+static void
+scalar_xmerge(MDB_IDL idl, MDB_IDL merge)
+{
+	MDB_ID old_id, merge_id, i = merge[0], j = idl[0], k = i+j, total = k;
+	idl[0] = (MDB_ID)-1;
+	old_id = idl[j];
+	while (i) {
+		merge_id = merge[i--];
+		for (; old_id < merge_id; old_id = idl[--j])
+			idl[k--] = old_id;
+		idl[k--] = merge_id;
+	}
+	idl[0] = total;
+}
+
+static double
+bench_midl_sort(void *arg, unsigned long n)
+{
+	midl_ctx *ctx = arg;
+	unsigned long i;
+	double t = 0, t0;
+
+	for (i = 0; i < n; i++) {
+		memcpy(ctx->work, ctx->src, (ctx->src[0] + 1) * sizeof(MDB_ID));
+		t0 = now();
+		ctx->sort(ctx->work);
+		t += now() - t0;
+	}
+	return t;
+}
+
+static double
+bench_mid2l_sort(void *arg, unsigned long n)
+{
+	midl_ctx *ctx = arg;
+	unsigned long i;
+	double t = 0, t0;
+
+	for (i = 0; i < n; i++) {
+		memcpy(ctx->work2, ctx->src2, (ctx->src2[0].mid + 1) * sizeof(MDB_ID2));
+		t0 = now();
+		mdb_mid2l_sort(ctx->work2);
+		t += now() - t0;
+	}
+	return t;
+}
+
+static double
+bench_midl_xmerge(void *arg, unsigned long n)
+{
+	midl_ctx *ctx = arg;
+	unsigned long i;
+	double t = 0, t0;
+
+	for (i = 0; i < n; i++) {
+		memcpy(ctx->work, ctx->src, (ctx->src[0] + 1) * sizeof(MDB_ID));
+		t0 = now();
+		ctx->xmerge(ctx->work, ctx->merge[i % ctx->merges]);
+		t += now() - t0;
+	}
+	return t;
+}
+
+static void
+random_idl(MDB_IDL idl, unsigned int size, MDB_ID range, uint64_t seed)
+{
+	unsigned int i;
+	idl[0] = size;
+	for (i = 1; i <= size; i++)
+		idl[i] = next_rand(&seed) % range + 2;
+}
+
+static void
+run_midl(void)
+{
+	static const unsigned int sizes[] = { 1024, 65536, 1048576 };
+	midl_ctx ctx;
+	char name[64];
+	unsigned int i, j, size;
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		size = sizes[i];
+		ctx.src = mdb_midl_alloc(size);
+		ctx.merges = (1U << 22) / size < MERGES ? (1U << 22) / size : MERGES;
+		for (j = 0; j < ctx.merges; j++)
+			ctx.merge[j] = mdb_midl_alloc(size);
+		ctx.work = mdb_midl_alloc(size * 2);
+		ctx.src2 = malloc((size + 1) * sizeof(MDB_ID2));
+		ctx.work2 = malloc((size + 1) * sizeof(MDB_ID2));
+
+		random_idl(ctx.src, size, (MDB_ID)size * 8, 7);
+		ctx.sort = mdb_midl_sort;
+		snprintf(name, sizeof(name), "midl_sort %u", size);
+		bench("midl", name, bench_midl_sort, &ctx);
+		ctx.sort = mdb_midl_qsort;
+		snprintf(name, sizeof(name), "midl_qsort %u", size);
+		bench("midl", name, bench_midl_sort, &ctx);
+
+		/* A dirty list appended out of order */
+		for (j = 0; j <= size; j++) {
+			ctx.src2[j].mid = ctx.src[j];
+			ctx.src2[j].mptr = NULL;
+		}
+		snprintf(name, sizeof(name), "mid2l_sort %u", size);
+		bench("midl", name, bench_mid2l_sort, &ctx);
+
+		/* xmerge takes sorted lists */
+		mdb_midl_sort(ctx.src);
+		for (j = 0; j < ctx.merges; j++) {
+			random_idl(ctx.merge[j], size, (MDB_ID)size * 8, 11 + j);
+			mdb_midl_sort(ctx.merge[j]);
+		}
+		ctx.xmerge = mdb_midl_xmerge;
+		snprintf(name, sizeof(name), "midl_xmerge %u+%u", size, size);
+		bench("midl", name, bench_midl_xmerge, &ctx);
+		ctx.xmerge = scalar_xmerge;
+		snprintf(name, sizeof(name), "scalar_xmerge %u+%u", size, size);
+		bench("midl", name, bench_midl_xmerge, &ctx);
+		ctx.xmerge = mdb_midl_xmerge;
+
+		/* One freeDB record into a long me_pghead */
+		for (j = 0; j < ctx.merges; j++) {
+			random_idl(ctx.merge[j], size / 64, (MDB_ID)size * 8, 11 + j);
+			mdb_midl_sort(ctx.merge[j]);
+		}
+		snprintf(name, sizeof(name), "midl_xmerge %u+%u", size, size / 64);
+		bench("midl", name, bench_midl_xmerge, &ctx);
+		ctx.xmerge = scalar_xmerge;
+		snprintf(name, sizeof(name), "scalar_xmerge %u+%u", size, size / 64);
+		bench("midl", name, bench_midl_xmerge, &ctx);
+		ctx.xmerge = mdb_midl_xmerge;
+
+		/* A few IDs into a long me_pghead, which gallops */
+		if (size / 4096) {
+			for (j = 0; j < ctx.merges; j++) {
+				random_idl(ctx.merge[j], size / 4096, (MDB_ID)size * 8, 11 + j);
+				mdb_midl_sort(ctx.merge[j]);
+			}
+			snprintf(name, sizeof(name), "midl_xmerge %u+%u", size, size / 4096);
+			bench("midl", name, bench_midl_xmerge, &ctx);
+			ctx.xmerge = scalar_xmerge;
+			snprintf(name, sizeof(name), "scalar_xmerge %u+%u", size, size / 4096);
+			bench("midl", name, bench_midl_xmerge, &ctx);
+		}
+
+		mdb_midl_free(ctx.src);
+		for (j = 0; j < ctx.merges; j++)
+			mdb_midl_free(ctx.merge[j]);
+		mdb_midl_free(ctx.work);
+		free(ctx.src2);
+		free(ctx.work2);
+	}
+}
+
+static void
+write_json(const char *path)
+{
+	FILE *f = fopen(path, "w");
+	time_t t = time(NULL);
+	char date[64];
+	int i;
+
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S UTC", gmtime(&t));
+	fprintf(f, "{\n  \"version\": \"native\",\n  \"lmdb\": \"%s\",\n", MDB_VERSION_STRING);
+	fprintf(f, "  \"time\": \"%s\",\n  \"results\": [\n", date);
+	for (i = 0; i < nresults; i++)
+		fprintf(f, "    {\"group\": \"%s\", \"name\": \"%s\", \"ips\": %.3f, "
+			"\"stddev\": %.3f, \"iterations\": %lu}%s\n",
+			results[i].group, results[i].name, results[i].ips,
+			results[i].stddev, results[i].iterations, i + 1 < nresults ? "," : "");
+	fprintf(f, "  ]\n}\n");
+	fclose(f);
+	printf("Results written to %s\n", path);
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *out = NULL;
+	int c;
+
+	while ((c = getopt(argc, argv, "t:o:s")) != -1) {
+		switch (c) {
+		case 't':
+			min_time = atof(optarg);
+			break;
+		case 'o':
+			out = optarg;
+			break;
+		case 's':
+			env_flags &= ~MDB_NOSYNC;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t seconds] [-o results.json] [-s] [group...]\n"
+				"groups: search put split commit alloc dirty midl\n", argv[0]);
+			return 1;
+		}
+	}
+	groups = argv + optind;
+	ngroups = argc - optind;
+
+	if (!mkdtemp(env_dir)) {
+		perror(env_dir);
+		return 1;
+	}
+	printf("%s, %s\n", MDB_VERSION_STRING,
+		env_flags & MDB_NOSYNC ? "MDB_NOSYNC" : "synchronous commits");
+	if (selected("search"))
+		run_node_search();
+	if (selected("put"))
+		run_cursor_put();
+	if (selected("split"))
+		run_page_split();
+	if (selected("commit"))
+		run_commit();
+	if (selected("alloc")) {
+		run_page_alloc();
+		run_pinned_alloc();
+	}
+	if (selected("dirty"))
+		run_dirty_lookup();
+	if (selected("midl"))
+		run_midl();
+	rmdir(env_dir);
+
+	if (out)
+		write_json(out);
+	return 0;
+}
@@ -0,0 +1,333 @@
+# YCSB-style workload driver: one environment, N reader processes and
+# one writer process, as LMDB is deployed with several processes.
+#
+#   rake bench:ycsb[a]
+#   ruby -Ilib bench/ycsb.rb --workload b --readers 8 --records 1000000
+#
+# The readers run the reads and scans of the mix, each in its own
+# read-only transaction, and the writer runs the updates, inserts and
+# read-modify-writes. The writer is paced by the reads done so far so
+# that the mix keeps its ratio; when it cannot keep up the achieved
+# ratio is reported. Keys follow the YCSB distributions, scrambled
+# zipfian except for workload D which reads the latest inserts.
+
+require 'lmdb'
+require 'fileutils'
+require 'json'
+require 'optparse'
+require 'tmpdir'
+
+module LMDB
+  module YCSB
+    # Operation weights of the core workloads
+    WORKLOADS = {
+      'a' => { :read => 50, :update => 50 },
+      'b' => { :read => 95, :update => 5 },
+      'c' => { :read => 100 },
+      'd' => { :read => 95, :insert => 5 },
+      'e' => { :scan => 95, :insert => 5 },
+      'f' => { :read => 50, :rmw => 50 },
+    }
+    READS = [:read, :scan]
+    PERCENTILES = [50, 95, 99, 99.9]
+    SAMPLES = 100_000
+
+    # Zipfian generator of YCSB, after Gray et al., "Quickly Generating
+    # Billion-Record Synthetic Databases"
+    class Zipfian
+      THETA = 0.99
+
+      def initialize(items)
+        @items = items
+        @alpha = 1 / (1 - THETA)
+        @zetan = zeta(items)
+        @eta = (1 - (2.0 / items)**(1 - THETA)) / (1 - zeta(2) / @zetan)
+      end
+
+      def next
+        u = rand
+        uz = u * @zetan
+        return 0 if uz < 1
+        return 1 if uz < 1 + 0.5**THETA
+        (@items * (@eta * u - @eta + 1)**@alpha).to_i
+      end
+
+      private
+
+      def zeta(n)
+        (1..n).inject(0.0) { |sum, i| sum + 1 / i.to_f**THETA }
+      end
+    end
+
+    # Reservoir of latency samples for one operation
+    class Recorder
+      attr_reader :count, :samples
+
+      def initialize
+        @count = 0
+        @samples = []
+      end
+
+      def time
+        start = Process.clock_gettime(Process::CLOCK_MONOTONIC, :microsecond)
+        yield
+        record(Process.clock_gettime(Process::CLOCK_MONOTONIC, :microsecond) - start)
+      end
+
+      def record(usec)
+        @count += 1
+        if @samples.size < SAMPLES
+          @samples << usec
+        elsif (i = rand(@count)) < SAMPLES
+          @samples[i] = usec
+        end
+      end
+    end
+
+    class Driver
+      def initialize(options)
+        @options = options
+        @mix = WORKLOADS.fetch(options[:workload])
+        @records = options[:records]
+        @value = 'x' * options[:value_size]
+        @zipf = Zipfian.new(@records)
+      end
+
+      def run
+        dir = @options[:path] || Dir.mktmpdir('lmdb-ycsb')
+        FileUtils.mkpath(dir)
+        @path = dir
+        load_records
+        # Shared counters: reads done by each reader, then inserted records
+        @progress = File.join(dir, 'progress')
+        File.binwrite(@progress, "\0" * 8 * (@options[:readers] + 1))
+
+        pipes = []
+        pids = (0..@options[:readers]).map do |i|
+          rd, wr = IO.pipe
+          pipes << rd
+          fork do
+            rd.close
+            recorders = i < @options[:readers] ? reader(i) : writer
+            Marshal.dump(recorders.map { |op, r| [op, r.count, r.samples] }, wr)
+            wr.close
+          end.tap { wr.close }
+        end
+        results = pipes.map { |rd| Marshal.load(rd) }
+        pids.each { |pid| Process.wait(pid) }
+        report(results)
+      ensure
+        FileUtils.rm_rf(dir) if dir && !@options[:path]
+      end
+
+      private
+
+      def key(i)
+        'user%016d' % i
+      end
+
+      def open_env
+        LMDB.new(@path, :mapsize => @options[:mapsize], :maxreaders => @options[:maxreaders],
+                 :nosync => @options[:nosync])
+      end
+
+      def load_records
+        env = open_env
+        db = env.database
+        # Keys sort in load order, so a partly loaded --path resumes at its size
+        if db.size < @records
+          (db.size...@records).each_slice(10_000) do |slice|
+            env.transaction { slice.each { |i| db.put(key(i), @value, :append => true) } }
+          end
+        end
+        @residency = env.residency
+        env.close
+      end
+
+      # Reads the counters of the other processes
+      def counter(file, i)
+        file.pread(8, 8 * i).unpack1('Q')
+      end
+
+      def publish(file, i, value)
+        file.pwrite([value].pack('Q'), 8 * i)
+      end
+
+      def deadline
+        Process.clock_gettime(Process::CLOCK_MONOTONIC) + @options[:time]
+      end
+
+      def choose(weights)
+        n = rand(weights.values.inject(:+))
+        weights.each { |op, w| return op if (n -= w) < 0 }
+      end
+
+      # Next key to read: the latest inserts for workload D, else
+      # scrambled zipfian over the records
+      def read_key(inserted)
+        count = @records + inserted
+        if @mix[:insert] && @options[:workload] == 'd'
+          key(count - 1 - [@zipf.next, count - 1].min)
+        else
+          key(@zipf.next.hash % count)
+        end
+      end
+
+      def reader(i)
+        env = open_env
+        db = env.database
+        mix = @mix.select { |op, _| READS.include?(op) }
+        recorders = Hash.new { |h, op| h[op] = Recorder.new }
+        File.open(@progress, 'r+b') do |file|
+          stop, done, inserted = deadline, 0, 0
+          until mix.empty? || Process.clock_gettime(Process::CLOCK_MONOTONIC) > stop
+            inserted = counter(file, @options[:readers]) if done % 100 == 0
+            op = choose(mix)
+            recorders[op].time do
+              env.transaction(true) do
+                if op == :read
+                  db.get(read_key(inserted))
+                else
+                  db.cursor do |c|
+                    c.set_range(read_key(inserted))
+                    rand(1..@options[:scan_length]).times { break unless c.next }
+                  end
+                end
+              end
+            end
+            done += 1
+            publish(file, i, done) if done % 100 == 0
+          end
+          publish(file, i, done)
+        end
+        env.close
+        recorders
+      end
+
+      def writer
+        env = open_env
+        db = env.database
+        mix = @mix.reject { |op, _| READS.include?(op) }
+        reads = @mix.select { |op, _| READS.include?(op) }.values.inject(0, :+)
+        ratio = reads > 0 ? mix.values.inject(0, :+).to_f / reads : nil
+        recorders = Hash.new { |h, op| h[op] = Recorder.new }
+        File.open(@progress, 'r+b') do |file|
+          stop, done, inserted = deadline, 0, 0
+          until mix.empty? || Process.clock_gettime(Process::CLOCK_MONOTONIC) > stop
+            if ratio
+              target = (0...@options[:readers]).inject(0) { |sum, i| sum + counter(file, i) } * ratio
+              if done >= target
+                sleep 0.0005
+                next
+              end
+            end
+            op = choose(mix)
+            recorders[op].time do
+              env.transaction do
+                case op
+                when :update
+                  db.put(read_key(inserted), @value)
+                when :insert
+                  db.put(key(@records + inserted), @value)
+                  inserted += 1
+                when :rmw
+                  k = read_key(inserted)
+                  db.put(k, db.get(k).to_s.succ)
+                end
+              end
+            end
+            publish(file, @options[:readers], inserted) if op == :insert
+            done += 1
+          end
+        end
+        env.close
+        recorders
+      end
+
+      def percentile(sorted, p)
+        sorted[[(sorted.size * p / 100.0).ceil - 1, 0].max]
+      end
+
+      def report(results)
+        ops = Hash.new { |h, op| h[op] = [0, []] }
+        results.each do |recorders|
+          recorders.each do |op, count, samples|
+            ops[op][0] += count
+            ops[op][1].concat(samples)
+          end
+        end
+
+        env = open_env
+        out = {
+          :workload => @options[:workload],
+          :readers => @options[:readers],
+          :records => @records,
+          :seconds => @options[:time],
+          :throughput => ops.values.map(&:first).inject(0, :+) / @options[:time].to_f,
+          :operations => {},
+          :residency_before => @residency,
+          :residency_after => env.residency,
+          :stat => env.stat,
+        }
+        env.close
+
+        puts "workload #{@options[:workload]}: #{@options[:readers]} readers, 1 writer, " \
+             "#{@records} records, #{@options[:time]}s"
+        puts '%-7s %10s %11s' % %w(op count ops/s) +
+             PERCENTILES.map { |p| '%9s' % "p#{p}" }.join + '%9s' % 'max'
+        ops.sort_by { |op, _| op.to_s }.each do |op, (count, samples)|
+          samples.sort!
+          stats = { :count => count, :throughput => count / @options[:time].to_f, :max => samples.last }
+          PERCENTILES.each { |p| stats[:"p#{p}"] = percentile(samples, p) }
+          out[:operations][op] = stats
+          puts '%-7s %10d %11.1f' % [op, count, stats[:throughput]] +
+               PERCENTILES.map { |p| '%9d' % stats[:"p#{p}"] }.join + '%9d' % stats[:max]
+        end
+        total = ops.values.map(&:first).inject(0, :+)
+        writes = ops.reject { |op, _| READS.include?(op) }.values.map(&:first).inject(0, :+)
+        out[:write_share] = total > 0 ? writes.to_f / total : 0
+        mix = @mix.reject { |op, _| READS.include?(op) }.values.inject(0, :+)
+        puts 'latencies in microseconds, total %.1f ops/s, %.1f%% writes (mix %d%%)' %
+             [out[:throughput], out[:write_share] * 100, mix]
+        puts "page cache: #{@residency[:resident]}/#{@residency[:pages]} pages before, " \
+             "#{out[:residency_after][:resident]}/#{out[:residency_after][:pages]} after"
+
+        if @options[:json]
+          File.write(@options[:json], JSON.pretty_generate(out))
+          puts "Results written to #{@options[:json]}"
+        end
+      end
+    end
+
+    def self.run(argv)
+      options = {
+        :workload => 'a',
+        :readers => 4,
+        :records => 100_000,
+        :value_size => 1000,
+        :time => 10,
+        :scan_length => 100,
+        :mapsize => 1 << 34,
+        :maxreaders => 126,
+        :nosync => false,
+      }
+      OptionParser.new do |o|
+        o.banner = "usage: #{$0} [options]"
+        o.on('-w', '--workload NAME', WORKLOADS.keys, 'YCSB workload a-f (a)') { |v| options[:workload] = v }
+        o.on('-r', '--readers N', Integer, 'Reader processes (4)') { |v| options[:readers] = v }
+        o.on('-n', '--records N', Integer, 'Records loaded (100000)') { |v| options[:records] = v }
+        o.on('-s', '--value-size BYTES', Integer, 'Value size (1000)') { |v| options[:value_size] = v }
+        o.on('-t', '--time SECONDS', Float, 'Run time (10)') { |v| options[:time] = v }
+        o.on('--scan-length N', Integer, 'Longest scan (100)') { |v| options[:scan_length] = v }
+        o.on('--maxreaders N', Integer, 'Reader table size (126)') { |v| options[:maxreaders] = v }
+        o.on('--mapsize BYTES', Integer, 'Map size (16GB)') { |v| options[:mapsize] = v }
+        o.on('--nosync', 'Do not sync on commit') { options[:nosync] = true }
+        o.on('--path DIR', 'Keep the environment in DIR') { |v| options[:path] = v }
+        o.on('--json FILE', 'Write the results as JSON') { |v| options[:json] = v }
+      end.parse!(argv)
+      Driver.new(options).run
+    end
+  end
+end
+
+LMDB::YCSB.run(ARGV) if $0 == __FILE__
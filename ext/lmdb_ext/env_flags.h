@@ -9,3 +9,15 @@ FLAG(NOTLS, notls)
 FLAG(NOLOCK, nolock)
 FLAG(NORDAHEAD, nordahead)
 FLAG(NOMEMINIT, nomeminit)
+#ifdef MDB_MAPPOPULATE
+FLAG(MAPPOPULATE, mappopulate)
+#endif
+#ifdef MDB_FREERANGES
+FLAG(FREERANGES, freeranges)
+#endif
+#ifdef MDB_SINGLESYNC
+FLAG(SINGLESYNC, singlesync)
+#endif
+#ifdef MDB_IOURING
+FLAG(IOURING, iouring)
+#endif
@@ -16,9 +16,11 @@ have_header 'stdlib.h'
 have_header 'errno.h'
 have_header 'sys/types.h'
 have_header 'assert.h'
+have_header 'sys/sdt.h'
 
 have_header 'ruby.h'
 have_func 'rb_funcall_passing_block'
+have_func 'rb_funcall_passing_block_kw'
 have_func 'rb_thread_call_without_gvl2'
 
 create_header
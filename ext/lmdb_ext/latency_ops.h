@@ -0,0 +1,8 @@
+OP(get)
+OP(put)
+OP(delete)
+OP(cursor_get)
+OP(cursor_put)
+OP(cursor_delete)
+OP(begin)
+OP(commit)
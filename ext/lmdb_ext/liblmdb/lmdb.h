@@ -287,6 +287,14 @@ typedef void (MDB_rel_func)(MDB_val *item, void *oldptr, void *newptr, void *rel
 #define MDB_NORDAHEAD	0x800000
 	/** don't initialize malloc'd memory before writing to datafile */
 #define MDB_NOMEMINIT	0x1000000
+	/** prefault the whole map when opening (Linux only) */
+#define MDB_MAPPOPULATE	0x2000000
+	/** save runs of freed pages as ranges in the freeDB */
+#define MDB_FREERANGES	0x4000000
+	/** write the meta page with the data and sync once per commit */
+#define MDB_SINGLESYNC	0x8000000
+	/** flush dirty pages through io_uring (Linux only) */
+#define MDB_IOURING		0x40000000
 /** @} */
 
 /**	@defgroup	mdb_dbi_open	Database Flags
@@ -438,6 +446,68 @@ typedef struct MDB_stat {
 	size_t		ms_entries;			/**< Number of data items */
 } MDB_stat;
 
+/** @brief A page visited by #mdb_walk() */
+typedef struct MDB_page_info {
+	size_t		mpi_pgno;			/**< Page number */
+	unsigned int	mpi_flags;			/**< Page type, see @ref mdb_walk */
+	unsigned int	mpi_depth;			/**< Level in the tree, 0 for the root. Pages
+											of a dupsort sub-DB count from its own root. */
+	unsigned int	mpi_pages;			/**< Number of pages, more than 1 only for
+											overflow pages */
+	unsigned int	mpi_nkeys;			/**< Number of items on the page */
+	size_t		mpi_used;			/**< Bytes in use, including the page header */
+} MDB_page_info;
+
+/** @brief A key/data item visited by #mdb_walk() */
+typedef struct MDB_node_info {
+	size_t		mni_pgno;			/**< Leaf page holding the item */
+	unsigned int	mni_flags;			/**< How the data is stored, see @ref mdb_walk */
+	size_t		mni_ksize;			/**< Size of the key */
+	size_t		mni_dsize;			/**< Size of the data. For duplicates, the size
+											of the sub-page or sub-DB record holding them. */
+	size_t		mni_dups;			/**< Number of data items for the key */
+	size_t		mni_pages;			/**< Overflow pages of a big data item,
+											or pages of a dupsort sub-DB */
+} MDB_node_info;
+
+	/** @defgroup mdb_walk	Tree Walk Flags
+	 *	Values of #MDB_page_info.mpi_flags and #MDB_node_info.mni_flags.
+	 *	@{
+	 */
+	/** branch page */
+#define MDB_WALK_BRANCH		0x01
+	/** leaf page */
+#define MDB_WALK_LEAF		0x02
+	/** overflow pages of a big data item */
+#define MDB_WALK_OVERFLOW	0x04
+	/** leaf page of fixed size items, see #MDB_DUPFIXED */
+#define MDB_WALK_LEAF2		0x08
+	/** page of a dupsort sub-DB, or item whose duplicates are in one */
+#define MDB_WALK_SUBDB		0x10
+	/** item whose data is on overflow pages */
+#define MDB_WALK_BIGDATA	0x20
+	/** item whose duplicates are on a sub-page of its leaf */
+#define MDB_WALK_DUPDATA	0x40
+	/** @} */
+
+	/** @brief A callback function for pages visited by #mdb_walk().
+	 *
+	 * @param[in] page The page being visited
+	 * @param[in] ctx The context passed to #mdb_walk()
+	 * @return 0 to continue, anything else stops the walk and is
+	 * returned by #mdb_walk().
+	 */
+typedef int (MDB_walk_page_func)(const MDB_page_info *page, void *ctx);
+
+	/** @brief A callback function for key/data items visited by #mdb_walk().
+	 *
+	 * @param[in] node The item being visited
+	 * @param[in] ctx The context passed to #mdb_walk()
+	 * @return 0 to continue, anything else stops the walk and is
+	 * returned by #mdb_walk().
+	 */
+typedef int (MDB_walk_node_func)(const MDB_node_info *node, void *ctx);
+
 /** @brief Information about the environment */
 typedef struct MDB_envinfo {
 	void	*me_mapaddr;			/**< Address of map, if fixed */
@@ -446,8 +516,58 @@ typedef struct MDB_envinfo {
 	size_t	me_last_txnid;			/**< ID of the last committed transaction */
 	unsigned int me_maxreaders;		/**< max reader slots in the environment */
 	unsigned int me_numreaders;		/**< max reader slots used in the environment */
+	unsigned int me_maxdirty;		/**< max dirty pages of a write transaction */
+	unsigned int me_writers;		/**< threads writing large flushes */
 } MDB_envinfo;
 
+/** @brief Performance counters of the environment
+ *
+ * The counters are kept per environment handle, i.e. they only cover
+ * write transactions of this process, and start at zero when the
+ * environment is opened. They are read and reset without the writer
+ * lock, so while another thread runs a write transaction they are
+ * approximate, and a reset may lose the counts of that transaction.
+ */
+typedef struct MDB_metrics {
+	size_t	mx_alloc_freelist;	/**< Pages allocated from the freelist */
+	size_t	mx_alloc_extend;	/**< Pages allocated by growing the file */
+	size_t	mx_alloc_loose;		/**< Loose pages reused within a txn */
+	size_t	mx_freedb_reads;	/**< Records read from the freeDB to refill the freelist */
+	size_t	mx_spills;			/**< Number of times dirty pages were spilled */
+	size_t	mx_spill_pages;		/**< Dirty pages spilled to the map */
+	size_t	mx_unspill_pages;	/**< Spilled pages copied back to be written again */
+	size_t	mx_flush_pages;		/**< Dirty pages flushed by commits and spills, including overflow pages */
+	size_t	mx_flush_bytes;		/**< Bytes written by page flushes */
+	size_t	mx_flush_writes;	/**< Write system calls issued by page flushes */
+	size_t	mx_freelist_records;	/**< Records written by freelist saves */
+	size_t	mx_freelist_pages;	/**< Page numbers stored in those records */
+	size_t	mx_splits;			/**< Page splits */
+	size_t	mx_merges;			/**< Page merges */
+	size_t	mx_extent_hits;		/**< Multi-page allocations served by the free-extent index */
+	size_t	mx_extent_rebuilds;	/**< Rebuilds of the free-extent index */
+	size_t	mx_dirty_hash_builds;	/**< Builds of a dirty list's hash index */
+	size_t	mx_arena_chunks;	/**< Chunks mapped for dirty page buffers */
+	size_t	mx_reader_scans;	/**< Scans of the reader table for the oldest reader */
+	size_t	mx_single_syncs;	/**< Commits made durable with a single sync, see #MDB_SINGLESYNC */
+	size_t	mx_uring_flushes;	/**< Page flushes submitted through io_uring, see #MDB_IOURING */
+	size_t	mx_writer_flushes;	/**< Page flushes split between writer threads, see #mdb_env_set_writers() */
+} MDB_metrics;
+
+/** @brief Time spent in the phases of a commit
+ *
+ * All times are in microseconds, as filled in by #mdb_txn_commit_ex().
+ * Phases that did not run, e.g. for a read-only or nested transaction,
+ * are zero.
+ */
+typedef struct MDB_commit_latency {
+	size_t	mcl_prepare;	/**< Updating the root records of named databases */
+	size_t	mcl_freelist;	/**< Saving the freelist to the freeDB */
+	size_t	mcl_write;		/**< Writing the dirty pages */
+	size_t	mcl_sync;		/**< Flushing the data pages to disk */
+	size_t	mcl_meta;		/**< Writing the meta page, including its sync */
+	size_t	mcl_total;		/**< The whole commit, including lock release */
+} MDB_commit_latency;
+
 	/** @brief Return the LMDB library version information.
 	 *
 	 * @param[out] major if non-NULL, the library major version number is copied here
@@ -587,6 +707,35 @@ int  mdb_env_create(MDB_env **env);
 	 *		caller is expected to overwrite all of the memory that was
 	 *		reserved in that case.
 	 *		This flag may be changed at any time using #mdb_env_set_flags().
+	 *	<li>#MDB_FREERANGES
+	 *		Save the pages freed by a transaction in the freeDB as (page, count)
+	 *		ranges when that is smaller than a list of page numbers, as after
+	 *		deleting many records or large values. Both formats are always
+	 *		read. The first commit that saves ranges gives the file a new
+	 *		data version, so that versions of LMDB without this flag refuse
+	 *		it with #MDB_VERSION_MISMATCH. The mark stays when the flag is
+	 *		turned off again.
+	 *		This flag may be changed at any time using #mdb_env_set_flags().
+	 *	<li>#MDB_SINGLESYNC
+	 *		Make a commit durable with one flush to disk instead of two. The
+	 *		meta page is written along with the data pages and carries
+	 *		checksums of them, and opening the environment after a crash
+	 *		falls back to the previous transaction if the last one did not
+	 *		fully reach the disk. Commits that spilled pages or that write
+	 *		more than a few dozen separate runs of pages still flush twice.
+	 *		Versions of LMDB without this flag ignore the checksums. The flag
+	 *		has no effect with #MDB_NOSYNC or #MDB_WRITEMAP.
+	 *		This flag may be changed at any time using #mdb_env_set_flags().
+	 *	<li>#MDB_IOURING
+	 *		Write the dirty pages of a commit through an io_uring, queueing
+	 *		all of them at once and the sync of the data file after them,
+	 *		so that the device sees many writes in flight. Linux 5.4 or
+	 *		later; where the ring cannot be set up, as on other systems or
+	 *		when io_uring is disabled, pages are written as without the
+	 *		flag. It has no effect with #MDB_WRITEMAP. A flush large enough
+	 *		to be split between the threads of #mdb_env_set_writers() does
+	 *		not use the ring, and the commit syncs the data file itself.
+	 *		This flag may be changed at any time using #mdb_env_set_flags().
 	 * </ul>
 	 * @param[in] mode The UNIX permissions to set on created files. This parameter
 	 * is ignored on Windows.
@@ -693,6 +842,73 @@ int  mdb_env_stat(MDB_env *env, MDB_stat *stat);
 	 */
 int  mdb_env_info(MDB_env *env, MDB_envinfo *stat);
 
+	/** @brief Return the performance counters of the LMDB environment.
+	 *
+	 * @param[in] env An environment handle returned by #mdb_env_create()
+	 * @param[out] metrics The address of an #MDB_metrics structure
+	 * 	where the counters will be copied
+	 * @param[in] flags Special options for this call. This parameter
+	 * must be set to 0 or by bitwise OR'ing together one or more of the
+	 * values described here.
+	 * <ul>
+	 *	<li>#MDB_METRICS_RESET
+	 *		Reset the counters to zero after copying them.
+	 * </ul>
+	 * The writer lock is not taken, see #MDB_metrics.
+	 * @return A non-zero error value on failure and 0 on success.
+	 */
+int  mdb_env_metrics(MDB_env *env, MDB_metrics *metrics, unsigned int flags);
+
+	/** Reset the counters after reading them, see #mdb_env_metrics() */
+#define MDB_METRICS_RESET	0x01
+
+	/** @brief Report which pages of the data file are in the OS page cache.
+	 *
+	 * The memory map is checked with mincore(), a few thousand OS pages at
+	 * a time. A page larger than an OS page is resident only if all of it
+	 * is. This only reports the state at the time of the call, it may
+	 * change at any moment.
+	 * @param[in] env An environment handle returned by #mdb_env_create()
+	 * @param[in] first The number of the first page to check
+	 * @param[in] count The number of pages to check
+	 * @param[out] vec An array of \b count bytes, set to 1 for each page
+	 *	which is resident and to 0 otherwise
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>EINVAL - the pages are beyond the map, or the environment is not open.
+	 *	<li>ENOSYS - the platform has no mincore().
+	 * </ul>
+	 */
+int  mdb_env_mincore(MDB_env *env, size_t first, size_t count, unsigned char *vec);
+
+	/** @defgroup mdb_advise	Access Pattern Hints
+	 *	@{
+	 */
+	/** no special treatment, the OS reads ahead moderately */
+#define MDB_ADVISE_NORMAL		0
+	/** point lookups, the OS should not read ahead */
+#define MDB_ADVISE_RANDOM		1
+	/** sequential scans, pages should be read ahead */
+#define MDB_ADVISE_SEQUENTIAL	2
+	/** @} */
+
+	/** @brief Tell the OS how the memory map of the environment is accessed.
+	 *
+	 * This applies madvise() to the whole map, and again whenever the map
+	 * is recreated. #MDB_ADVISE_RANDOM has the same effect as #MDB_NORDAHEAD
+	 * but can be changed at any time. It can be combined with cursors that
+	 * read ahead, see #mdb_cursor_advise().
+	 * @param[in] env An environment handle returned by #mdb_env_create()
+	 * @param[in] advice One of the @ref mdb_advise values
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>EINVAL - an invalid parameter was specified.
+	 * </ul>
+	 */
+int  mdb_env_advise(MDB_env *env, int advice);
+
 	/** @brief Flush the data buffers to disk.
 	 *
 	 * Data is always written to disk when #mdb_txn_commit() is called,
@@ -712,6 +928,31 @@ int  mdb_env_info(MDB_env *env, MDB_envinfo *stat);
 	 */
 int  mdb_env_sync(MDB_env *env, int force);
 
+	/** @brief Wait until a transaction newer than the given one is committed.
+	 *
+	 * This function blocks until the ID of the last transaction committed
+	 * to the environment, by any process, is greater than \b txnid.
+	 * On Linux the waiting is done on a futex in the lock file, which the
+	 * committing process signals after releasing the writer lock. On other
+	 * platforms, or with #MDB_NOLOCK, the meta pages are polled.
+	 * @param[in] env An environment handle returned by #mdb_env_create()
+	 * @param[in] txnid The transaction ID to wait past
+	 * @param[in] msec Maximum time to wait in milliseconds, or #MDB_WAIT_FOREVER
+	 * @param[out] last Optional address where the ID of the last committed
+	 * transaction is stored
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>ETIMEDOUT - no newer transaction was committed within \b msec.
+	 *	<li>EINTR - the wait was interrupted by a signal.
+	 *	<li>EINVAL - an invalid parameter was specified.
+	 * </ul>
+	 */
+int  mdb_env_wait_commit(MDB_env *env, size_t txnid, unsigned int msec, size_t *last);
+
+	/** Timeout value for #mdb_env_wait_commit() that never expires */
+#define MDB_WAIT_FOREVER	((unsigned int)-1)
+
 	/** @brief Close the environment and release the memory map.
 	 *
 	 * Only a single thread may call this function. All transactions, databases,
@@ -861,6 +1102,80 @@ int  mdb_env_get_maxreaders(MDB_env *env, unsigned int *readers);
 	 */
 int  mdb_env_set_maxdbs(MDB_env *env, MDB_dbi dbs);
 
+	/** @brief Set the maximum number of dirty pages of a write transaction.
+	 *
+	 * A write transaction keeps the pages it changes in memory. When it has
+	 * more than this number of dirty pages, some of them are spilled, i.e.
+	 * written to the map before commit, and copied back if they are written
+	 * again. Past the limit a transaction fails with #MDB_TXN_FULL if no
+	 * pages can be spilled. The list of dirty pages starts small and grows
+	 * as needed, so a large limit costs no memory until a transaction uses
+	 * it. The grown list is kept for later write transactions until the
+	 * environment is closed. The default is 131071 pages.
+	 * This function may only be called after #mdb_env_create() and before #mdb_env_open().
+	 * @param[in] env An environment handle returned by #mdb_env_create()
+	 * @param[in] pages The maximum number of dirty pages, at least #MDB_MAXDIRTY_MIN
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>EINVAL - an invalid parameter was specified, or the environment is already open.
+	 * </ul>
+	 */
+int  mdb_env_set_maxdirty(MDB_env *env, unsigned int pages);
+
+	/** Smallest limit accepted by #mdb_env_set_maxdirty() */
+#define MDB_MAXDIRTY_MIN	1024
+
+	/** @brief Get the maximum number of dirty pages of a write transaction.
+	 *
+	 * @param[in] env An environment handle returned by #mdb_env_create()
+	 * @param[out] pages Address of an integer to store the number of pages
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>EINVAL - an invalid parameter was specified.
+	 * </ul>
+	 */
+int  mdb_env_get_maxdirty(MDB_env *env, unsigned int *pages);
+
+	/** @brief Set the number of threads writing large flushes.
+	 *
+	 * A commit or spill that writes many dirty pages splits the sorted list
+	 * of pages into runs, one per thread, and writes them concurrently before
+	 * the data file is synced. The committing thread writes one of the runs,
+	 * and the others are started by the first such flush. A run has at least
+	 * #MDB_WRITER_PAGES dirty pages (4096 by default, the overflow pages of a
+	 * value counting as one), so smaller flushes are written as before.
+	 * Flushes with #MDB_WRITEMAP are not written by the library, and split
+	 * flushes do not use the ring of #MDB_IOURING.
+	 * The default is 1, writing from the committing thread only. Platforms
+	 * without pwritev() ignore this setting.
+	 * This function may only be called after #mdb_env_create() and before #mdb_env_open().
+	 * @param[in] env An environment handle returned by #mdb_env_create()
+	 * @param[in] writers The number of threads, from 1 to #MDB_WRITERS_MAX
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>EINVAL - an invalid parameter was specified, or the environment is already open.
+	 * </ul>
+	 */
+int  mdb_env_set_writers(MDB_env *env, unsigned int writers);
+
+	/** Most threads accepted by #mdb_env_set_writers() */
+#define MDB_WRITERS_MAX	16
+
+	/** @brief Get the number of threads writing large flushes.
+	 *
+	 * @param[in] env An environment handle returned by #mdb_env_create()
+	 * @param[out] writers Address of an integer to store the number of threads
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>EINVAL - an invalid parameter was specified.
+	 * </ul>
+	 */
+int  mdb_env_get_writers(MDB_env *env, unsigned int *writers);
+
 	/** @brief Get the maximum size of keys and #MDB_DUPSORT data we can write.
 	 *
 	 * Depends on the compile-time constant #MDB_MAXKEYSIZE. Default 511.
@@ -962,6 +1277,21 @@ MDB_env *mdb_txn_env(MDB_txn *txn);
 	 */
 int  mdb_txn_commit(MDB_txn *txn);
 
+	/** @brief Commit a transaction and report the time spent in each phase.
+	 *
+	 * This is the same as #mdb_txn_commit(), but also measures the commit.
+	 * @param[in] txn A transaction handle returned by #mdb_txn_begin()
+	 * @param[out] latency The address of an #MDB_commit_latency structure
+	 * 	to fill in, or NULL to skip the measurement. It is filled in
+	 * 	even when the commit fails.
+	 * @return A non-zero error value on failure and 0 on success, see
+	 * #mdb_txn_commit().
+	 */
+int  mdb_txn_commit_ex(MDB_txn *txn, MDB_commit_latency *latency);
+
+	/** Defined when #mdb_txn_commit_ex() is available */
+#define MDB_COMMIT_LATENCY	1
+
 	/** @brief Abandon all the operations of the transaction instead of saving them.
 	 *
 	 * The transaction handle is freed. It and its cursors must not be used
@@ -1092,6 +1422,74 @@ int  mdb_dbi_open(MDB_txn *txn, const char *name, unsigned int flags, MDB_dbi *d
 	 */
 int  mdb_stat(MDB_txn *txn, MDB_dbi dbi, MDB_stat *stat);
 
+	/** @brief Visit every page and item of a database.
+	 *
+	 * The tree is walked depth-first in key order. A page is visited
+	 * before its children, and a leaf before its items. The overflow
+	 * pages of a big item are visited before the item, and so are the
+	 * pages of a dupsort sub-DB, whose items are not visited.
+	 * The walk only reads the database, within the given transaction.
+	 * @param[in] txn A transaction handle returned by #mdb_txn_begin()
+	 * @param[in] dbi A database handle returned by #mdb_dbi_open()
+	 * @param[in] page_func Called for each page, or NULL
+	 * @param[in] node_func Called for each key/data item, or NULL
+	 * @param[in] ctx An arbitrary pointer passed to the callbacks
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>EINVAL - an invalid parameter was specified.
+	 *	<li>#MDB_CORRUPTED - the tree is deeper than any valid tree.
+	 * </ul>
+	 * Any non-zero value returned by a callback is returned as is.
+	 */
+int  mdb_walk(MDB_txn *txn, MDB_dbi dbi, MDB_walk_page_func *page_func,
+	MDB_walk_node_func *node_func, void *ctx);
+
+	/** @defgroup mdb_warm	Warm-up Flags
+	 *	@{
+	 */
+	/** also prefetch the leaf pages */
+#define MDB_WARM_LEAVES		0x01
+	/** also prefetch overflow pages, this reads the leaf pages */
+#define MDB_WARM_OVERFLOW	0x02
+	/** read the pages instead of advising the OS to prefetch them */
+#define MDB_WARM_TOUCH		0x04
+	/** @} */
+
+	/** @brief Bring the pages of a database into the OS page cache.
+	 *
+	 * The branch pages leading to the keys in the range are read, and the
+	 * pages below them are prefetched one level at a time with
+	 * madvise(MADV_WILLNEED), so the OS can read them in parallel.
+	 * Dupsort sub-DBs are not prefetched.
+	 * @param[in] txn A read-only transaction handle returned by #mdb_txn_begin()
+	 * @param[in] dbi A database handle returned by #mdb_dbi_open()
+	 * @param[in] from The first key of the range, or NULL to start at the first key
+	 * @param[in] to The last key of the range, or NULL to end at the last key
+	 * @param[in] flags Special options for this call. This parameter
+	 * must be set to 0 or by bitwise OR'ing together one or more of the
+	 * values described here.
+	 * <ul>
+	 *	<li>#MDB_WARM_LEAVES
+	 *		Also prefetch the leaf pages. By default only branch pages are,
+	 *		which removes most page faults of lookups in a cold database.
+	 *	<li>#MDB_WARM_OVERFLOW
+	 *		Also prefetch overflow pages. This reads every leaf page in the range.
+	 *	<li>#MDB_WARM_TOUCH
+	 *		Read every page synchronously instead. This is the default on
+	 *		platforms without madvise().
+	 * </ul>
+	 * @param[out] pages If not NULL, the number of pages prefetched
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>EINVAL - an invalid parameter was specified, or the transaction
+	 *		is not read-only.
+	 * </ul>
+	 */
+int  mdb_warm(MDB_txn *txn, MDB_dbi dbi, MDB_val *from, MDB_val *to,
+	unsigned int flags, size_t *pages);
+
 	/** @brief Retrieve the DB flags for a database handle.
 	 *
 	 * @param[in] txn A transaction handle returned by #mdb_txn_begin()
@@ -1374,6 +1772,24 @@ MDB_txn *mdb_cursor_txn(MDB_cursor *cursor);
 	 */
 MDB_dbi mdb_cursor_dbi(MDB_cursor *cursor);
 
+	/** @brief Tell how a cursor will move through its database.
+	 *
+	 * With #MDB_ADVISE_SEQUENTIAL, whenever the cursor reaches a new leaf
+	 * page the OS is asked to prefetch the next leaf page and the overflow
+	 * pages of the leaf's remaining large values, so forward scans do not
+	 * stall on every page even when readahead is off for the environment.
+	 * #mdb_cursor_renew() resets the hint.
+	 * @param[in] cursor A cursor handle returned by #mdb_cursor_open()
+	 * @param[in] advice #MDB_ADVISE_SEQUENTIAL, or #MDB_ADVISE_NORMAL or
+	 *	#MDB_ADVISE_RANDOM to stop reading ahead
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>EINVAL - an invalid parameter was specified.
+	 * </ul>
+	 */
+int  mdb_cursor_advise(MDB_cursor *cursor, int advice);
+
 	/** @brief Retrieve by cursor.
 	 *
 	 * This function retrieves key/data pairs from the database. The address and length
@@ -108,6 +108,47 @@ extern int cacheflush(char *addr, int nbytes, int cache);
 # define MDB_FDATASYNC		fsync
 #endif
 
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+/** Commits are signalled to waiting processes through a futex on the
+ *	shared txnid in the lock file.
+ */
+#define MDB_USE_FUTEX	1
+#endif
+
+	/** Flush pages through io_uring with #MDB_IOURING, when the kernel
+	 *	headers have it. Define as 0 to leave it out.
+	 */
+#ifndef MDB_USE_IOURING
+# if defined(__linux__) && defined(__NR_io_uring_setup) && defined(__has_include)
+#  if __has_include(<linux/io_uring.h>)
+#   define MDB_USE_IOURING	1
+#  endif
+# endif
+# ifndef MDB_USE_IOURING
+#  define MDB_USE_IOURING	0
+# endif
+#endif
+#if MDB_USE_IOURING
+#include <linux/io_uring.h>
+# ifndef IORING_FEAT_SINGLE_MMAP	/* headers older than Linux 5.4 */
+#  undef MDB_USE_IOURING
+#  define MDB_USE_IOURING	0
+# endif
+#endif
+
+	/** Write large flushes from several threads with #mdb_env_set_writers(),
+	 *	where pwritev() is available. Define as 0 to leave it out.
+	 */
+#ifndef MDB_USE_WRITERS
+# if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#  define MDB_USE_WRITERS	1
+# else
+#  define MDB_USE_WRITERS	0
+# endif
+#endif
+
 #ifndef _WIN32
 #include <pthread.h>
 #ifdef MDB_USE_POSIX_SEM
@@ -131,6 +172,49 @@ extern int cacheflush(char *addr, int nbytes, int cache);
 #define VGMEMP_DEFINED(a,s)
 #endif
 
+	/** Use USDT probes from <sys/sdt.h> when the compiler can find it.
+	 *	Define as 0 to disable them.
+	 */
+#ifndef MDB_USE_SDT
+# ifdef __has_include
+#  if __has_include(<sys/sdt.h>)
+#   define MDB_USE_SDT	1
+#  endif
+# endif
+# ifndef MDB_USE_SDT
+#  define MDB_USE_SDT	0
+# endif
+#endif
+
+	/** @defgroup probes	USDT Probes
+	 *	Static tracepoints of the \b liblmdb provider, for bpftrace,
+	 *	SystemTap or DTrace. They compile to a no-op instruction, and to
+	 *	nothing at all without <sys/sdt.h>.
+	 *	<ul>
+	 *	<li>txn__begin(txn, txnid, rdonly)
+	 *	<li>txn__commit(txn, txnid), txn__commit__done(txn, rc)
+	 *	<li>txn__abort(txn, txnid)
+	 *	<li>wmutex__acquire(env), wmutex__acquired(env), wmutex__release(env)
+	 *	<li>page__alloc(pgno, num, source): source is 0 for a loose page,
+	 *		1 for the freelist and 2 for growing the file
+	 *	<li>page__spill(txn, need), page__spill__done(txn, rc)
+	 *	<li>page__split(pgno, newpgno, nkeys)
+	 *	<li>page__flush(txn, pages), page__flush__done(txn, pages)
+	 *	</ul>
+	 *	@{
+	 */
+#if MDB_USE_SDT
+#include <sys/sdt.h>
+#define MDB_PROBE1(name,a)	DTRACE_PROBE1(liblmdb, name, a)
+#define MDB_PROBE2(name,a,b)	DTRACE_PROBE2(liblmdb, name, a, b)
+#define MDB_PROBE3(name,a,b,c)	DTRACE_PROBE3(liblmdb, name, a, b, c)
+#else
+#define MDB_PROBE1(name,a)
+#define MDB_PROBE2(name,a,b)
+#define MDB_PROBE3(name,a,b,c)
+#endif
+	/** @} */
+
 #ifndef BYTE_ORDER
 # if (defined(_LITTLE_ENDIAN) || defined(_BIG_ENDIAN)) && !(defined(_LITTLE_ENDIAN) && defined(_BIG_ENDIAN))
 /* Solaris just defines one or the other */
@@ -435,6 +519,11 @@ static txnid_t mdb_debug_start;
 
 	/**	The version number for a database's datafile format. */
 #define MDB_DATA_VERSION	 ((MDB_DEVEL) ? 999 : 1)
+	/**	The version number of a datafile whose freeDB may hold range
+	 *	records (#MDB_FREERANGES). Versions of LMDB that cannot read them
+	 *	refuse it. It is kept once set, even without the flag.
+	 */
+#define MDB_RANGES_VERSION	 ((MDB_DEVEL) ? 1000 : 2)
 	/**	The version number for a database's lockfile format. */
 #define MDB_LOCK_VERSION	 1
 
@@ -638,6 +727,12 @@ typedef struct MDB_txbody {
 		 *	when readers release their slots.
 		 */
 	unsigned	mtb_numreaders;
+		/** The number of threads blocked in #mdb_env_wait_commit().
+		 *	Committers only signal the futex when this is non-zero.
+		 *	It occupies what used to be padding, so the lock file layout
+		 *	is unchanged.
+		 */
+	uint32_t	mtb_waiters;
 } MDB_txbody;
 
 	/** The actual reader table definition. */
@@ -650,6 +745,7 @@ typedef struct MDB_txninfo {
 #define mti_rmname	mt1.mtb.mtb_rmname
 #define mti_txnid	mt1.mtb.mtb_txnid
 #define mti_numreaders	mt1.mtb.mtb_numreaders
+#define mti_waiters	mt1.mtb.mtb_waiters
 		char pad[(sizeof(MDB_txbody)+CACHELINE-1) & ~(CACHELINE-1)];
 	} mt1;
 	union {
@@ -911,6 +1007,38 @@ typedef struct MDB_meta {
 	txnid_t		mm_txnid;			/**< txnid that committed this page */
 } MDB_meta;
 
+	/** A run of pages written by a commit, see #MDB_metasum */
+typedef struct MDB_sumrun {
+	pgno_t		sr_pgno;		/**< first page of the run */
+	pgno_t		sr_count;		/**< number of pages in the run */
+} MDB_sumrun;
+
+/** Most page runs a meta can list for a #MDB_SINGLESYNC commit.
+ *	A commit writing more runs syncs twice, as without the flag.
+ */
+#ifndef MDB_SUM_RUNS
+#define MDB_SUM_RUNS	64
+#endif
+
+	/** Checksums of a #MDB_SINGLESYNC commit, stored right after the
+	 *	#MDB_meta in its meta page. Such a meta is written together with
+	 *	the data pages and synced once, so after a crash it can be on disk
+	 *	while some of the pages it refers to are not. Opening the
+	 *	environment verifies the checksums and passes over a meta that
+	 *	fails them for the previous one, whose pages the commit did not
+	 *	touch. The record belongs to the meta only while #ms_txnid matches.
+	 */
+typedef struct MDB_metasum {
+	uint32_t	ms_crc;			/**< CRC-32C of the meta and the rest of this record */
+	uint32_t	ms_datacrc;		/**< CRC-32C of the pages in #ms_runs */
+	txnid_t		ms_txnid;		/**< txnid of the meta, 0 if it has no checksums */
+	pgno_t		ms_nruns;		/**< number of entries in #ms_runs */
+	MDB_sumrun	ms_runs[MDB_SUM_RUNS];	/**< the pages written by the commit */
+} MDB_metasum;
+
+	/** Address of the checksum record following a meta */
+#define METASUM(m)	((MDB_metasum *)((MDB_meta *)(m) + 1))
+
 	/** Buffer for a stack-allocated meta page.
 	 *	The members define size and alignment, and silence type
 	 *	aliasing warnings.  They are not used directly; that could
@@ -921,6 +1049,7 @@ typedef union MDB_metabuf {
 	struct {
 		char		mm_pad[PAGEHDRSZ];
 		MDB_meta	mm_meta;
+		MDB_metasum	mm_sum;
 	} mb_metabuf;
 } MDB_metabuf;
 
@@ -936,6 +1065,35 @@ typedef struct MDB_dbx {
 	void		*md_relctx;		/**< user-provided context for md_rel */
 } MDB_dbx;
 
+/** Number of entries a dirty list is first allocated with. It
+ * doubles as needed, up to the environment's maxdirty setting.
+ */
+#ifndef MDB_DIRTY_INIT
+#define MDB_DIRTY_INIT	4095
+#endif
+
+/** Length of a dirty list from which lookups use a hash index
+ * instead of a binary search.
+ */
+#ifndef MDB_DHASH_MIN
+#define MDB_DHASH_MIN	512
+#endif
+
+	/** Hash index of a write txn's dirty list, from page number to
+	 *	dirty page. It uses open addressing with linear probing; an
+	 *	empty slot has mid 0, which is never a dirty page. The index
+	 *	is built when a lookup finds the dirty list at least
+	 *	#MDB_DHASH_MIN long, then kept in step with single pages
+	 *	added to or removed from the list. Bulk changes to the list,
+	 *	or too many entries, make it stale until the next lookup.
+	 */
+typedef struct MDB_dhash {
+	MDB_ID2		*dh_tab;	/**< the slots */
+	unsigned	dh_size;	/**< allocated slots, a power of 2 */
+	unsigned	dh_shift;	/**< shift of a hash to a slot number */
+	unsigned	dh_valid;	/**< the index matches the dirty list */
+} MDB_dhash;
+
 	/** A database transaction.
 	 *	Every operation requires a transaction handle.
 	 */
@@ -1001,14 +1159,19 @@ struct MDB_txn {
 #define MDB_TXN_ERROR		0x02		/**< txn is unusable after an error */
 #define MDB_TXN_DIRTY		0x04		/**< must write, even if dirty list is empty */
 #define MDB_TXN_SPILLS		0x08		/**< txn or a parent has spilled pages */
+#define MDB_TXN_RANGES		0x10		/**< txn saved range records to the freeDB */
 /** @} */
 	unsigned int	mt_flags;		/**< @ref mdb_txn */
-	/** #dirty_list room: Array size - \#dirty pages visible to this txn.
+	/** #dirty_list room: #MDB_env.me_maxdirty - \#dirty pages visible to this txn.
 	 *	Includes ancestor txns' dirty pages not hidden by other txns'
 	 *	dirty/spilled pages. Thus commit(nested txn) has room to merge
 	 *	dirty_list into mt_parent after freeing hidden mt_parent pages.
 	 */
 	unsigned int	mt_dirty_room;
+	/** Number of entries #mt_u.dirty_list has space for */
+	unsigned int	mt_dirty_cap;
+	/** For write txns: hash index of #mt_u.dirty_list */
+	MDB_dhash	mt_dhash;
 };
 
 /** Enough space for 2^32 nodes with minimum of 2 keys per node. I.e., plenty.
@@ -1017,6 +1180,25 @@ struct MDB_txn {
  */
 #define CURSOR_STACK		 32
 
+/** Number of keys before the end of a leaf at which #mdb_cursor_next()
+ * prefetches the next leaf into the CPU cache.
+ */
+#ifndef MDB_PREFETCH_KEYS
+#define MDB_PREFETCH_KEYS	8
+#endif
+
+/** Number of leaf pages a #C_SEQUENTIAL cursor asks the OS to read ahead. */
+#ifndef MDB_READAHEAD_LEAVES
+#define MDB_READAHEAD_LEAVES	16
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+	/** Hint the CPU to load a cache line, a no-op if it is not mapped */
+#define MDB_PREFETCH(p)	__builtin_prefetch(p)
+#else
+#define MDB_PREFETCH(p)	((void)0)
+#endif
+
 struct MDB_xcursor;
 
 	/** Cursors are used for all DB operations.
@@ -1055,10 +1237,14 @@ struct MDB_cursor {
 #define C_EOF	0x02			/**< No more data */
 #define C_SUB	0x04			/**< Cursor is a sub-cursor */
 #define C_DEL	0x08			/**< last op was a cursor_del */
+#define C_SEQUENTIAL	0x10	/**< Cursor reads ahead, see #mdb_cursor_advise() */
 #define C_SPLITTING	0x20		/**< Cursor is in page_split */
 #define C_UNTRACK	0x40		/**< Un-track cursor when closing */
 /** @} */
 	unsigned int	mc_flags;	/**< @ref mdb_cursor */
+	pgno_t		mc_rapg;	/**< last leaf read ahead from, if #C_SEQUENTIAL */
+	pgno_t		mc_rapp;	/**< branch page whose children were read ahead */
+	indx_t		mc_raend;	/**< index in #mc_rapp past the last leaf read ahead */
 	MDB_page	*mc_pg[CURSOR_STACK];	/**< stack of pushed pages */
 	indx_t		mc_ki[CURSOR_STACK];	/**< stack of page indices */
 };
@@ -1085,6 +1271,138 @@ typedef struct MDB_pgstate {
 	txnid_t		mf_pglast;	/**< ID of last used record, or 0 if !mf_pghead */
 } MDB_pgstate;
 
+/** Length of me_pghead from which multi-page allocations may use the
+ * free-extent index, and the fewest pages scanned at its tail first.
+ */
+#ifndef MDB_PGRUNS_MIN
+#define MDB_PGRUNS_MIN	256
+#endif
+
+	/** A run of two or more consecutive pages in me_pghead */
+typedef struct MDB_pgrun {
+	pgno_t		mr_pgno;	/**< lowest page of the run */
+	pgno_t		mr_len;		/**< number of pages, 0 once used up */
+} MDB_pgrun;
+
+	/** Free-extent index of me_pghead, for multi-page allocations.
+	 *	The runs are in ascending page order, and mr_tree is a max-tree
+	 *	of their lengths, so the lowest run of a given length is found
+	 *	in O(log n). The index belongs to the me_pghead it was built
+	 *	from and with that length; any other change to me_pghead makes
+	 *	it stale and it is rebuilt on next use. Runs are checked against
+	 *	me_pghead before they are used.
+	 */
+typedef struct MDB_pgruns {
+	MDB_pgrun	*mr_runs;	/**< the runs, ascending */
+	pgno_t		*mr_tree;	/**< max lengths, leaves at [mr_cap, 2*mr_cap) */
+	unsigned	mr_num;		/**< number of runs */
+	unsigned	mr_first;	/**< first run not used up */
+	unsigned	mr_cap;		/**< leaves in mr_tree, a power of 2 */
+	unsigned	mr_size;	/**< allocated runs */
+	unsigned	mr_scanned;	/**< pages scanned without the index since it was built */
+	pgno_t		*mr_mop;	/**< me_pghead the index describes */
+	pgno_t		mr_mop_len;	/**< its length then */
+} MDB_pgruns;
+
+/** Size of the chunks single dirty pages are carved from */
+#ifndef MDB_ARENA_CHUNK
+#define MDB_ARENA_CHUNK	(8U << 20)
+#endif
+
+/** Number of arena chunks kept mapped for the next write txn */
+#ifndef MDB_ARENA_KEEP
+#define MDB_ARENA_KEEP	4
+#endif
+
+	/** Arena of dirty page buffers. Single pages are carved from large
+	 *	anonymous mappings, which use transparent huge pages where
+	 *	available, and are all released at once when the top-level
+	 *	write txn ends. Pages freed during the txn go to me_dpages for
+	 *	reuse. Overflow buffers are malloc'd and freed on their own, so
+	 *	that freeing or spilling them during the txn releases memory.
+	 */
+typedef struct MDB_arena {
+	char		**ma_chunks;	/**< mapped chunks */
+	unsigned	ma_num;		/**< number of mapped chunks */
+	unsigned	ma_size;	/**< allocated slots in ma_chunks */
+	unsigned	ma_used;	/**< chunks in use, the last one partly */
+	size_t		ma_off;		/**< bytes used of the last chunk in use */
+} MDB_arena;
+
+#if MDB_USE_IOURING
+/** Submission queue size of the ring used by #MDB_IOURING flushes */
+#ifndef MDB_URING_ENTRIES
+#define MDB_URING_ENTRIES	128
+#endif
+
+	/** An io_uring for flushing dirty pages, set up by the first flush
+	 *	of an environment with #MDB_IOURING and used only by its write
+	 *	txn. Both rings share one mapping, which needs Linux 5.4. Where
+	 *	the ring cannot be set up, or once it failed, flushes use
+	 *	pwritev() as without the flag.
+	 */
+typedef struct MDB_uring {
+	int			mu_state;	/**< 0 not set up yet, 1 ready, -1 unavailable */
+	int			mu_fd;		/**< the ring */
+	char		*mu_map;	/**< mapping of both rings */
+	size_t		mu_mapsize;
+	struct io_uring_sqe	*mu_sqes;	/**< submission queue entries */
+	unsigned	mu_sqentries;
+	unsigned	mu_sqmask;
+	unsigned	*mu_sqtail;
+	struct io_uring_cqe	*mu_cqes;	/**< completion queue entries */
+	unsigned	mu_cqentries;
+	unsigned	mu_cqmask;
+	unsigned	*mu_cqhead;
+	unsigned	*mu_cqtail;
+	unsigned	mu_pending;	/**< entries queued, not yet submitted */
+	unsigned	mu_inflight;	/**< entries submitted, not yet completed */
+	int			mu_err;		/**< first error of the completions */
+	struct iovec	*mu_iov;	/**< iovecs of the writes in flight */
+	size_t		mu_iovcap;	/**< allocated iovecs */
+} MDB_uring;
+#endif
+
+#if MDB_USE_WRITERS
+/** Fewest dirty pages a flush gives each writer thread */
+#ifndef MDB_WRITER_PAGES
+#define MDB_WRITER_PAGES	4096
+#endif
+
+	/** A run of the dirty list written by one thread of a flush */
+typedef struct MDB_wseg {
+	int			ws_lo;		/**< first index in the dirty list */
+	int			ws_hi;		/**< index past the run */
+	int			ws_rc;		/**< result of the writes */
+	size_t		ws_bytes;	/**< bytes written */
+	size_t		ws_writes;	/**< system calls made */
+} MDB_wseg;
+
+	/** Threads writing the runs of large flushes, started by the first
+	 *	such flush of an environment with #mdb_env_set_writers(). The
+	 *	committing thread writes runs too, and waits for all of them
+	 *	before the sync.
+	 */
+typedef struct MDB_wpool {
+	pthread_mutex_t	wp_mutex;
+	pthread_cond_t	wp_cond;	/**< signaled for new runs or to stop */
+	pthread_cond_t	wp_done;	/**< signaled when the last run is written */
+	MDB_ID2L	wp_dl;		/**< dirty list being flushed */
+	int			wp_nsegs;	/**< runs of this flush */
+	int			wp_next;	/**< next run to write */
+	int			wp_left;	/**< runs not written yet */
+	int			wp_stop;	/**< the threads should exit */
+	int			wp_nthreads;	/**< threads started */
+	pthread_t	wp_threads[MDB_WRITERS_MAX];
+	MDB_wseg	wp_segs[MDB_WRITERS_MAX];
+} MDB_wpool;
+#endif
+
+	/** Test if the free-extent index describes me_pghead */
+#define MDB_PGRUNS_VALID(env) \
+	((env)->me_pgruns.mr_mop == (env)->me_pghead && \
+	 (env)->me_pgruns.mr_mop_len == (env)->me_pghead[0])
+
 	/** The database environment. */
 struct MDB_env {
 	HANDLE		me_fd;		/**< The main data file */
@@ -1100,6 +1418,8 @@ struct MDB_env {
 	unsigned int	me_psize;	/**< DB page size, inited from me_os_psize */
 	unsigned int	me_os_psize;	/**< OS page size, from #GET_PAGESIZE */
 	unsigned int	me_maxreaders;	/**< size of the reader table */
+	unsigned int	me_maxdirty;	/**< max dirty pages of a write txn */
+	unsigned int	me_writers;		/**< threads writing large flushes */
 	unsigned int	me_numreaders;	/**< max numreaders set by this env */
 	MDB_dbi		me_numdbs;		/**< number of DBs opened */
 	MDB_dbi		me_maxdbs;		/**< size of the DB table */
@@ -1119,14 +1439,26 @@ struct MDB_env {
 	unsigned int	*me_dbiseqs;	/**< array of dbi sequence numbers */
 	pthread_key_t	me_txkey;	/**< thread-key for readers */
 	txnid_t		me_pgoldest;	/**< ID of oldest reader last time we looked */
+	pgno_t		me_pgoldest_next;	/**< mt_next_pgno from which to look again */
+	txnid_t		me_badtxnid;	/**< txnid of a torn meta passed over by a read-only open */
+	uint32_t	me_badcrc;		/**< its #ms_crc */
 	MDB_pgstate	me_pgstate;		/**< state of old pages from freeDB */
 #	define		me_pglast	me_pgstate.mf_pglast
 #	define		me_pghead	me_pgstate.mf_pghead
-	MDB_page	*me_dpages;		/**< list of malloc'd blocks for re-use */
+	MDB_pgruns	me_pgruns;		/**< free-extent index of me_pghead */
+	MDB_page	*me_dpages;		/**< list of freed single pages for re-use */
+	MDB_arena	me_arena;		/**< dirty page buffers */
+#if MDB_USE_IOURING
+	MDB_uring	me_uring;		/**< ring for #MDB_IOURING flushes */
+#endif
+#if MDB_USE_WRITERS
+	MDB_wpool	*me_wpool;		/**< writer threads of large flushes */
+#endif
 	/** IDL of pages that became unused in a write txn */
 	MDB_IDL		me_free_pgs;
-	/** ID2L of pages written during a write txn. Length MDB_IDL_UM_SIZE. */
+	/** ID2L of pages written during a write txn. Length me_dirty_cap+1. */
 	MDB_ID2L	me_dirty_list;
+	unsigned int	me_dirty_cap;	/**< entries me_dirty_list has space for */
 	/** Max number of freelist items that can fit in a single overflow page */
 	int			me_maxfree_1pg;
 	/** Max size of a node on a page */
@@ -1145,8 +1477,16 @@ struct MDB_env {
 #endif
 	void		*me_userctx;	 /**< User-settable context */
 	MDB_assert_func *me_assert_func; /**< Callback for assertion failures */
+	MDB_metrics	me_metrics;		/**< performance counters, see #mdb_env_metrics() */
+	int			me_advice;		/**< access pattern, see #mdb_env_advise() */
 };
 
+	/** Add to a performance counter of the environment.
+	 *	Only write txns update counters, and they are serialized by
+	 *	the writer mutex.
+	 */
+#define MDB_METRIC(env, name, n)	((env)->me_metrics.mx_##name += (n))
+
 	/** Nested transaction */
 typedef struct MDB_ntxn {
 	MDB_txn		mnt_txn;		/**< the transaction */
@@ -1192,7 +1532,8 @@ static int	mdb_page_split(MDB_cursor *mc, MDB_val *newkey, MDB_val *newdata,
 
 static int  mdb_env_read_header(MDB_env *env, MDB_meta *meta);
 static int  mdb_env_pick_meta(const MDB_env *env);
-static int  mdb_env_write_meta(MDB_txn *txn);
+static int  mdb_env_write_meta(MDB_txn *txn, MDB_metasum *sum);
+static void mdb_env_notify(MDB_env *env);
 #if !(defined(_WIN32) || defined(MDB_USE_POSIX_SEM)) /* Drop unused excl arg */
 # define mdb_env_close0(env, excl) mdb_env_close1(env)
 #endif
@@ -1499,7 +1840,7 @@ static void mdb_audit(MDB_txn *txn)
 	freecount = 0;
 	mdb_cursor_init(&mc, txn, FREE_DBI, NULL);
 	while ((rc = mdb_cursor_get(&mc, &key, &data, MDB_NEXT)) == 0)
-		freecount += *(MDB_ID *)data.mv_data;
+		freecount += mdb_midl_count(data.mv_data);
 	mdb_tassert(txn, rc == MDB_NOTFOUND);
 
 	count = 0;
@@ -1551,8 +1892,82 @@ mdb_dcmp(MDB_txn *txn, MDB_dbi dbi, const MDB_val *a, const MDB_val *b)
 	return txn->mt_dbxs[dbi].md_dcmp(a, b);
 }
 
+/** Carve a buffer from the dirty page arena.
+ * @param[in] env the environment.
+ * @param[in] sz the size of the buffer, at most #MDB_ARENA_CHUNK.
+ * @return the buffer, or NULL if a chunk could not be mapped.
+ */
+static void *
+mdb_arena_alloc(MDB_env *env, size_t sz)
+{
+	MDB_arena *ma = &env->me_arena;
+	char *p;
+
+	if (!ma->ma_used || ma->ma_off + sz > MDB_ARENA_CHUNK) {
+		if (ma->ma_used == ma->ma_num) {
+			if (ma->ma_num == ma->ma_size) {
+				unsigned size = ma->ma_size ? ma->ma_size * 2 : 16;
+				char **chunks = realloc(ma->ma_chunks, size * sizeof(char *));
+				if (!chunks)
+					return NULL;
+				ma->ma_chunks = chunks;
+				ma->ma_size = size;
+			}
+#ifdef _WIN32
+			p = VirtualAlloc(NULL, MDB_ARENA_CHUNK, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+			if (!p)
+				return NULL;
+#else
+			p = mmap(NULL, MDB_ARENA_CHUNK, PROT_READ|PROT_WRITE,
+				MAP_PRIVATE|MAP_ANON, -1, 0);
+			if (p == MAP_FAILED)
+				return NULL;
+#ifdef MADV_HUGEPAGE
+			madvise(p, MDB_ARENA_CHUNK, MADV_HUGEPAGE);
+#endif
+#endif
+			ma->ma_chunks[ma->ma_num++] = p;
+			MDB_METRIC(env, arena_chunks, 1);
+		}
+		ma->ma_used++;
+		ma->ma_off = 0;
+	}
+	p = ma->ma_chunks[ma->ma_used - 1] + ma->ma_off;
+	ma->ma_off += sz;
+	return p;
+}
+
+/** Unmap arena chunks from \b keep on. */
+static void
+mdb_arena_unmap(MDB_arena *ma, unsigned keep)
+{
+	while (ma->ma_num > keep) {
+		char *p = ma->ma_chunks[--ma->ma_num];
+#ifdef _WIN32
+		VirtualFree(p, 0, MEM_RELEASE);
+#else
+		munmap(p, MDB_ARENA_CHUNK);
+#endif
+	}
+}
+
+/** Release all dirty page buffers at the end of a top-level write txn.
+ * A few chunks stay mapped for the next txn.
+ */
+static void
+mdb_arena_reset(MDB_env *env)
+{
+	MDB_arena *ma = &env->me_arena;
+
+	mdb_arena_unmap(ma, MDB_ARENA_KEEP);
+	ma->ma_used = 0;
+	ma->ma_off = 0;
+	env->me_dpages = NULL;
+}
+
 /** Allocate memory for a page.
- * Re-use old malloc'd pages first for singletons, otherwise just malloc.
+ * Re-use freed pages first for singletons, otherwise carve from the
+ * arena, or malloc an overflow buffer.
  */
 static MDB_page *
 mdb_page_malloc(MDB_txn *txn, unsigned num)
@@ -1577,7 +1992,8 @@ mdb_page_malloc(MDB_txn *txn, unsigned num)
 		sz *= num;
 		off = sz - psize;
 	}
-	if ((ret = malloc(sz)) != NULL) {
+	ret = num == 1 ? mdb_arena_alloc(env, sz) : malloc(sz);
+	if (ret != NULL) {
 		VGMEMP_ALLOC(env, ret, sz);
 		if (!(env->me_flags & MDB_NOMEMINIT)) {
 			memset((char *)ret + off, 0, psize);
@@ -1613,6 +2029,155 @@ mdb_dpage_free(MDB_env *env, MDB_page *dp)
 	}
 }
 
+/** Slot of a page number in a dirty list hash index */
+#define MDB_DHASH_SLOT(dh, pgno) \
+	((unsigned)(((pgno) * (pgno_t)0x9E3779B97F4A7C15ULL) >> (dh)->dh_shift))
+
+/** Add a page to the hash index of a txn's dirty list.
+ * Makes the index stale rather than fill it beyond half.
+ * @param[in] txn the transaction.
+ * @param[in] id the page number and page.
+ */
+static void
+mdb_dhash_add(MDB_txn *txn, MDB_ID2 *id)
+{
+	MDB_dhash *dh = &txn->mt_dhash;
+	unsigned x, mask = dh->dh_size - 1;
+
+	if (!dh->dh_valid)
+		return;
+	if (txn->mt_u.dirty_list[0].mid * 2 > dh->dh_size) {
+		dh->dh_valid = 0;
+		return;
+	}
+	for (x = MDB_DHASH_SLOT(dh, id->mid); dh->dh_tab[x].mid; x = (x + 1) & mask)
+		;
+	dh->dh_tab[x] = *id;
+}
+
+/** Remove a page from the hash index of a txn's dirty list.
+ * Later entries of its probe sequence are moved back into the gap.
+ * @param[in] txn the transaction.
+ * @param[in] pgno the page number.
+ */
+static void
+mdb_dhash_del(MDB_txn *txn, pgno_t pgno)
+{
+	MDB_dhash *dh = &txn->mt_dhash;
+	unsigned x, y, home, mask = dh->dh_size - 1;
+
+	if (!dh->dh_valid)
+		return;
+	for (x = MDB_DHASH_SLOT(dh, pgno); dh->dh_tab[x].mid != pgno; x = (x + 1) & mask)
+		if (!dh->dh_tab[x].mid)
+			return;
+	for (y = (x + 1) & mask; dh->dh_tab[y].mid; y = (y + 1) & mask) {
+		home = MDB_DHASH_SLOT(dh, dh->dh_tab[y].mid);
+		/* Move y into the gap at x unless its home is in (x, y] */
+		if (((y - home) & mask) >= ((y - x) & mask)) {
+			dh->dh_tab[x] = dh->dh_tab[y];
+			x = y;
+		}
+	}
+	dh->dh_tab[x].mid = 0;
+}
+
+/** Build the hash index of a txn's dirty list.
+ * @param[in] txn the transaction.
+ * @return 0 on success, ENOMEM if the index could not be allocated.
+ */
+static int
+mdb_dhash_build(MDB_txn *txn)
+{
+	MDB_dhash *dh = &txn->mt_dhash;
+	MDB_ID2L dl = txn->mt_u.dirty_list;
+	unsigned i, n = dl[0].mid, size = 4096, shift = sizeof(pgno_t) * CHAR_BIT - 12;
+
+	/* Room to double before reaching half full. A larger table
+	 * from an earlier build is reused.
+	 */
+	while (size < n * 4 || size < dh->dh_size) {
+		size <<= 1;
+		shift--;
+	}
+	if (size > dh->dh_size) {
+		MDB_ID2 *tab = malloc(size * sizeof(MDB_ID2));
+		if (!tab)
+			return ENOMEM;
+		free(dh->dh_tab);
+		dh->dh_tab = tab;
+		dh->dh_size = size;
+	}
+	memset(dh->dh_tab, 0, dh->dh_size * sizeof(MDB_ID2));
+	dh->dh_shift = shift;
+	dh->dh_valid = 1;
+	for (i = 1; i <= n; i++)
+		mdb_dhash_add(txn, &dl[i]);
+	MDB_METRIC(txn->mt_env, dirty_hash_builds, 1);
+	return MDB_SUCCESS;
+}
+
+/** Find a page in a txn's own dirty list.
+ * Long dirty lists are searched through their hash index.
+ * @param[in] txn the transaction.
+ * @param[in] pgno the page number.
+ * @return the dirty page, or NULL if it is not in the list.
+ */
+static MDB_page *
+mdb_dlist_find(MDB_txn *txn, pgno_t pgno)
+{
+	MDB_ID2L dl = txn->mt_u.dirty_list;
+	MDB_dhash *dh = &txn->mt_dhash;
+	unsigned x;
+
+	if (dl[0].mid >= MDB_DHASH_MIN &&
+		(dh->dh_valid || mdb_dhash_build(txn) == MDB_SUCCESS)) {
+		unsigned mask = dh->dh_size - 1;
+		for (x = MDB_DHASH_SLOT(dh, pgno); dh->dh_tab[x].mid; x = (x + 1) & mask)
+			if (dh->dh_tab[x].mid == pgno)
+				return dh->dh_tab[x].mptr;
+		return NULL;
+	}
+	if (dl[0].mid) {
+		x = mdb_mid2l_search(dl, pgno);
+		if (x <= dl[0].mid && dl[x].mid == pgno)
+			return dl[x].mptr;
+	}
+	return NULL;
+}
+
+/** Make room for more entries in a txn's dirty list.
+ * The list doubles in size as needed, up to the environment's
+ * maxdirty setting or \b num entries if more are asked for.
+ * @param[in] txn the transaction.
+ * @param[in] num the number of entries the list must have space for.
+ * @return 0 on success, ENOMEM if the list could not be grown.
+ */
+static int
+mdb_dlist_grow(MDB_txn *txn, unsigned num)
+{
+	MDB_env *env = txn->mt_env;
+	MDB_ID2L dl;
+	unsigned cap = txn->mt_dirty_cap;
+
+	if (num <= cap)
+		return MDB_SUCCESS;
+	while (cap < num)
+		cap = cap * 2 + 1;
+	if (cap > env->me_maxdirty)
+		cap = num > env->me_maxdirty ? num : env->me_maxdirty;
+	dl = realloc(txn->mt_u.dirty_list, (cap + 1) * sizeof(MDB_ID2));
+	if (!dl)
+		return ENOMEM;
+	txn->mt_u.dirty_list = dl;
+	txn->mt_dirty_cap = cap;
+	if (!txn->mt_parent) {
+		env->me_dirty_list = dl;
+		env->me_dirty_cap = cap;
+	}
+	return MDB_SUCCESS;
+}
+
 /**	Return all dirty pages to dpage list */
 static void
 mdb_dlist_free(MDB_txn *txn)
@@ -1625,6 +2190,7 @@ mdb_dlist_free(MDB_txn *txn)
 		mdb_dpage_free(env, dl[i].mptr);
 	}
 	dl[0].mid = 0;
+	txn->mt_dhash.dh_valid = 0;
 }
 
 /** Loosen or free a single page.
@@ -1646,21 +2212,18 @@ mdb_page_loose(MDB_cursor *mc, MDB_page *mp)
 
 	if ((mp->mp_flags & P_DIRTY) && mc->mc_dbi != FREE_DBI) {
 		if (txn->mt_parent) {
-			MDB_ID2 *dl = txn->mt_u.dirty_list;
 			/* If txn has a parent, make sure the page is in our
 			 * dirty list.
 			 */
-			if (dl[0].mid) {
-				unsigned x = mdb_mid2l_search(dl, pgno);
-				if (x <= dl[0].mid && dl[x].mid == pgno) {
-					if (mp != dl[x].mptr) { /* bad cursor? */
-						mc->mc_flags &= ~(C_INITIALIZED|C_EOF);
-						txn->mt_flags |= MDB_TXN_ERROR;
-						return MDB_CORRUPTED;
-					}
-					/* ok, it's ours */
-					loose = 1;
+			MDB_page *dp = mdb_dlist_find(txn, pgno);
+			if (dp) {
+				if (mp != dp) { /* bad cursor? */
+					mc->mc_flags &= ~(C_INITIALIZED|C_EOF);
+					txn->mt_flags |= MDB_TXN_ERROR;
+					return MDB_CORRUPTED;
 				}
+				/* ok, it's ours */
+				loose = 1;
 			}
 		} else {
 			/* no parent txn, so it's just ours */
@@ -1749,7 +2312,7 @@ mdb_pages_xkeep(MDB_cursor *mc, unsigned pflags, int all)
 	return rc;
 }
 
-static int mdb_page_flush(MDB_txn *txn, int keep);
+static int mdb_page_flush(MDB_txn *txn, int keep, int *synced);
 
 /**	Spill pages from the dirty list back to disk.
  * This is intended to prevent running into #MDB_TXN_FULL situations,
@@ -1809,6 +2372,7 @@ mdb_page_spill(MDB_cursor *m0, MDB_val *key, MDB_val *data)
 	if (txn->mt_dirty_room > i)
 		return MDB_SUCCESS;
 
+	MDB_PROBE2(page__spill, txn, need);
 	if (!txn->mt_spill_pgs) {
 		txn->mt_spill_pgs = mdb_midl_alloc(MDB_IDL_UM_MAX);
 		if (!txn->mt_spill_pgs)
@@ -1836,8 +2400,8 @@ mdb_page_spill(MDB_cursor *m0, MDB_val *key, MDB_val *data)
 	 * of the dirty pages. Testing revealed this to be a good tradeoff,
 	 * better than 1/2, 1/4, or 1/10.
 	 */
-	if (need < MDB_IDL_UM_MAX / 8)
-		need = MDB_IDL_UM_MAX / 8;
+	if (need < txn->mt_env->me_maxdirty / 8)
+		need = txn->mt_env->me_maxdirty / 8;
 
 	/* Save the page IDs of all the pages we're flushing */
 	/* flush from the tail forward, this saves a lot of shifting later on. */
@@ -1866,11 +2430,13 @@ mdb_page_spill(MDB_cursor *m0, MDB_val *key, MDB_val *data)
 		if ((rc = mdb_midl_append(&txn->mt_spill_pgs, pn)))
 			goto done;
 		need--;
+		MDB_METRIC(txn->mt_env, spill_pages, 1);
 	}
 	mdb_midl_sort(txn->mt_spill_pgs);
+	MDB_METRIC(txn->mt_env, spills, 1);
 
 	/* Flush the spilled part of dirty list */
-	if ((rc = mdb_page_flush(txn, i)) != MDB_SUCCESS)
+	if ((rc = mdb_page_flush(txn, i, NULL)) != MDB_SUCCESS)
 		goto done;
 
 	/* Reset any dirty pages we kept that page_flush didn't see */
@@ -1878,18 +2444,35 @@ mdb_page_spill(MDB_cursor *m0, MDB_val *key, MDB_val *data)
 
 done:
 	txn->mt_flags |= rc ? MDB_TXN_ERROR : MDB_TXN_SPILLS;
+	MDB_PROBE2(page__spill__done, txn, rc);
 	return rc;
 }
 
-/** Find oldest txnid still referenced. Expects txn->mt_txnid > 0. */
+/** Number of pages a write txn grows the file by before it scans the
+ * reader table again for the oldest reader.
+ */
+#ifndef MDB_OLDEST_RESCAN
+#define MDB_OLDEST_RESCAN	256
+#endif
+
+/** Find oldest txnid still referenced. Expects txn->mt_txnid > 0.
+ * The reader table is scanned once per write txn, then again only
+ * after the txn has grown the file by #MDB_OLDEST_RESCAN pages. In
+ * between the last result is used; readers only move forward, so it
+ * stays a safe lower bound.
+ */
 static txnid_t
 mdb_find_oldest(MDB_txn *txn)
 {
+	MDB_env *env = txn->mt_env;
 	int i;
 	txnid_t mr, oldest = txn->mt_txnid - 1;
-	if (txn->mt_env->me_txns) {
-		MDB_reader *r = txn->mt_env->me_txns->mti_readers;
-		for (i = txn->mt_env->me_txns->mti_numreaders; --i >= 0; ) {
+
+	if (txn->mt_next_pgno < env->me_pgoldest_next)
+		return env->me_pgoldest;
+	if (env->me_txns) {
+		MDB_reader *r = env->me_txns->mti_readers;
+		for (i = env->me_txns->mti_numreaders; --i >= 0; ) {
 			if (r[i].mr_pid) {
 				mr = r[i].mr_txnid;
 				if (oldest > mr)
@@ -1897,6 +2480,9 @@ mdb_find_oldest(MDB_txn *txn)
 			}
 		}
 	}
+	env->me_pgoldest = oldest;
+	env->me_pgoldest_next = txn->mt_next_pgno + MDB_OLDEST_RESCAN;
+	MDB_METRIC(env, reader_scans, 1);
 	return oldest;
 }
 
@@ -1916,9 +2502,219 @@ mdb_page_dirty(MDB_txn *txn, MDB_page *mp)
 	mid.mptr = mp;
 	rc = insert(txn->mt_u.dirty_list, &mid);
 	mdb_tassert(txn, rc == 0);
+	mdb_dhash_add(txn, &mid);
 	txn->mt_dirty_room--;
 }
 
+/** Set the length of a run in the free-extent index.
+ * @param[in] pr the index.
+ * @param[in] k the run to update.
+ * @param[in] len its new length, 0 or 1 when it is used up.
+ */
+static void
+mdb_pgruns_set(MDB_pgruns *pr, unsigned k, pgno_t len)
+{
+	pgno_t *tree = pr->mr_tree, max;
+	unsigned x = pr->mr_cap + k;
+
+	if (len < 2)
+		len = 0;
+	pr->mr_runs[k].mr_len = len;
+	tree[x] = len;
+	for (; x > 1; x >>= 1) {
+		max = tree[x|1] > tree[x & ~1] ? tree[x|1] : tree[x & ~1];
+		if (tree[x>>1] == max)
+			break;
+		tree[x>>1] = max;
+	}
+	while (pr->mr_first < pr->mr_num && !pr->mr_runs[pr->mr_first].mr_len)
+		pr->mr_first++;
+}
+
+/** Make sure the free-extent index describes the current me_pghead,
+ * rebuilding it if not.
+ * @param[in] env the environment.
+ * @return 1 if the index can be used, 0 if it could not be allocated.
+ */
+static int
+mdb_pgruns_ready(MDB_env *env)
+{
+	MDB_pgruns *pr = &env->me_pgruns;
+	pgno_t *mop = env->me_pghead, pgno, *tree;
+	unsigned i, j, n, cap;
+
+	if (MDB_PGRUNS_VALID(env))
+		return 1;
+	pr->mr_mop = NULL;
+
+	n = mop[0] / 2 + 1;
+	if (pr->mr_size < n) {
+		MDB_pgrun *runs;
+		for (cap = pr->mr_size ? pr->mr_size : 64; cap < n; cap <<= 1)
+			;
+		if (!(runs = realloc(pr->mr_runs, cap * sizeof(MDB_pgrun))))
+			return 0;
+		pr->mr_runs = runs;
+		if (!(tree = realloc(pr->mr_tree, 2 * cap * sizeof(pgno_t))))
+			return 0;
+		pr->mr_tree = tree;
+		pr->mr_size = cap;
+	}
+
+	/* Collect the runs from the tail of me_pghead, lowest first */
+	n = 0;
+	for (i = mop[0]; i; i = j) {
+		pgno = mop[i];
+		for (j = i-1; j && mop[j] == pgno + (i-j); j--)
+			;
+		if (i - j > 1) {
+			pr->mr_runs[n].mr_pgno = pgno;
+			pr->mr_runs[n].mr_len = i - j;
+			n++;
+		}
+	}
+
+	for (cap = 1; cap < n; cap <<= 1)
+		;
+	tree = pr->mr_tree;
+	for (i = 0; i < cap; i++)
+		tree[cap + i] = i < n ? pr->mr_runs[i].mr_len : 0;
+	for (i = cap; --i; )
+		tree[i] = tree[2*i] > tree[2*i+1] ? tree[2*i] : tree[2*i+1];
+	pr->mr_num = n;
+	pr->mr_first = 0;
+	pr->mr_cap = cap;
+	pr->mr_mop = mop;
+	pr->mr_mop_len = mop[0];
+	pr->mr_scanned = 0;
+	MDB_METRIC(env, extent_rebuilds, 1);
+	return 1;
+}
+
+/** Find the lowest run of at least \b num pages in me_pghead,
+ * using the free-extent index.
+ * @param[in] env the environment.
+ * @param[in] num the number of pages wanted, at least 2.
+ * @return the position in me_pghead of the lowest page of the run,
+ * or 0 if there is none.
+ */
+static unsigned
+mdb_pgruns_find(MDB_env *env, int num)
+{
+	MDB_pgruns *pr = &env->me_pgruns;
+	pgno_t *mop = env->me_pghead, pgno, *tree = pr->mr_tree;
+	unsigned x, i, n2 = num-1;
+	int rebuilt = 0;
+
+	for (;;) {
+		if (!pr->mr_num || tree[1] < (pgno_t)num)
+			return 0;
+		for (x = 1; x < pr->mr_cap; )
+			x = tree[2*x] >= (pgno_t)num ? 2*x : 2*x+1;
+		pgno = pr->mr_runs[x - pr->mr_cap].mr_pgno;
+		i = mdb_midl_search(mop, pgno);
+		if (i <= mop[0] && mop[i] == pgno && i > n2 && mop[i-n2] == pgno+n2)
+			return i;
+		/* me_pghead changed without us noticing */
+		if (rebuilt++)
+			return 0;
+		pr->mr_mop = NULL;
+		if (!mdb_pgruns_ready(env))
+			return 0;
+	}
+}
+
+/** Update the free-extent index after \b num pages starting at
+ * position \b i were taken from me_pghead, before me_pghead is updated.
+ * Allocations always take the lowest pages of a run.
+ * @param[in] env the environment.
+ * @param[in] i position in me_pghead of the lowest page taken.
+ * @param[in] num the number of pages taken.
+ */
+static void
+mdb_pgruns_take(MDB_env *env, unsigned i, int num)
+{
+	MDB_pgruns *pr = &env->me_pgruns;
+	pgno_t *mop = env->me_pghead, pgno = mop[i];
+	MDB_pgrun *run;
+	unsigned lo, hi, mid;
+
+	if (!MDB_PGRUNS_VALID(env))
+		return;
+	pr->mr_mop_len -= num;
+	if (num == 1 && (i == 1 || mop[i-1] != pgno+1))
+		return;		/* a single free page, not indexed */
+
+	/* Binary search for the run by its lowest page */
+	lo = pr->mr_first;
+	hi = pr->mr_num;
+	while (lo < hi) {
+		mid = (lo + hi) >> 1;
+		if (pr->mr_runs[mid].mr_pgno < pgno)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	run = &pr->mr_runs[lo];
+	if (lo == pr->mr_num || run->mr_pgno != pgno || run->mr_len < (pgno_t)num) {
+		pr->mr_mop = NULL;
+		return;
+	}
+	run->mr_pgno += num;
+	mdb_pgruns_set(pr, lo, run->mr_len - num);
+}
+
+/** Look for a run of at least \b num pages around the pages of \b idl,
+ * just merged into me_pghead, which may hold ranges. Within a run mop[x] + x is constant, and
+ * it decreases from one run to the next, so the ends of the run holding
+ * a page are found with a binary search.
+ * @param[in] mop me_pghead.
+ * @param[in] idl the merged IDL.
+ * @param[in] num the number of pages wanted.
+ * @return the position in \b mop of the lowest page of such a run, or 0.
+ */
+static unsigned
+mdb_pgruns_merged(pgno_t *mop, pgno_t *idl, int num)
+{
+	pgno_t pgno, skip = 0, c;
+	unsigned k, x, lo, hi, mid, top, len = mop[0];
+	int ranges = MDB_IDL_IS_RANGES(idl);
+
+	/* A range lies in a single run, so one page of it is enough */
+	for (k = ranges ? MDB_IDL_NRANGES(idl) : idl[0]; k; k--) {
+		pgno = ranges ? idl[2*k-1] : idl[k];
+		if (pgno < skip)
+			continue;	/* in the run just measured */
+		x = mdb_midl_search(mop, pgno);
+		c = mop[x] + x;
+		/* last position of the run, its lowest page */
+		lo = x;
+		hi = len;
+		while (lo < hi) {
+			mid = (lo + hi + 1) >> 1;
+			if (mop[mid] + mid == c)
+				lo = mid;
+			else
+				hi = mid - 1;
+		}
+		top = lo;
+		/* first position of the run */
+		lo = 1;
+		hi = x;
+		while (lo < hi) {
+			mid = (lo + hi) >> 1;
+			if (mop[mid] + mid == c)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		if (top - lo + 1 >= (unsigned)num)
+			return top;
+		skip = mop[lo] + 1;
+	}
+	return 0;
+}
+
 /** Allocate page numbers and memory for writing.  Maintain me_pglast,
  * me_pghead and mt_next_pgno.
  *
@@ -1957,13 +2753,16 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 	txnid_t oldest = 0, last;
 	MDB_cursor_op op;
 	MDB_cursor m2;
-	int found_old = 0;
+	pgno_t *idl = NULL;
+	int found_old = 0, merged = 0;
 
 	/* If there are any loose pages, just use them */
 	if (num == 1 && txn->mt_loose_pgs) {
 		np = txn->mt_loose_pgs;
 		txn->mt_loose_pgs = NEXT_LOOSE_PAGE(np);
 		txn->mt_loose_count--;
+		MDB_METRIC(env, alloc_loose, 1);
+		MDB_PROBE3(page__alloc, np->mp_pgno, 1, 0);
 		DPRINTF(("db %d use loose page %"Z"u", DDBI(mc),
 				np->mp_pgno));
 		*mp = np;
@@ -1977,22 +2776,54 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 		rc = MDB_TXN_FULL;
 		goto fail;
 	}
+	if ((rc = mdb_dlist_grow(txn, txn->mt_u.dirty_list[0].mid + 1)))
+		goto fail;
 
 	for (op = MDB_FIRST;; op = MDB_NEXT) {
 		MDB_val key, data;
 		MDB_node *leaf;
-		pgno_t *idl;
 
 		/* Seek a big enough contiguous page range. Prefer
 		 * pages at the tail, just truncating the list.
 		 */
 		if (mop_len > n2) {
-			i = mop_len;
-			do {
-				pgno = mop[i];
-				if (mop[i-n2] == pgno+n2)
+			if (merged) {
+				/* Only runs touching the new pages can have grown enough */
+				if ((i = mdb_pgruns_merged(mop, idl, num)) != 0) {
+					pgno = mop[i];
+					goto search_done;
+				}
+			} else {
+				/* A run is often near the tail. Once scans cost as
+				 * much as building the free-extent index, use that.
+				 */
+				j = n2;
+				if (num > 1 && mop_len >= MDB_PGRUNS_MIN) {
+					MDB_pgruns *pr = &env->me_pgruns;
+					if (MDB_PGRUNS_VALID(env))
+						j = mop_len;
+					else if (pr->mr_scanned + MDB_PGRUNS_MIN < mop_len)
+						j = pr->mr_scanned;
+					else
+						j = mop_len - MDB_PGRUNS_MIN;
+					if (j < n2)
+						j = n2;
+				}
+				for (i = mop_len; i > j; i--) {
+					pgno = mop[i];
+					if (mop[i-n2] == pgno+n2)
+						break;
+				}
+				env->me_pgruns.mr_scanned += mop_len - i;
+				if (i > j)
 					goto search_done;
-			} while (--i > n2);
+				if (j > n2 && mdb_pgruns_ready(env) &&
+					(i = mdb_pgruns_find(env, num)) != 0) {
+					pgno = mop[i];
+					MDB_METRIC(env, extent_hits, 1);
+					goto search_done;
+				}
+			}
 			if (--retry < 0)
 				break;
 		}
@@ -2018,7 +2849,6 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 		if (oldest <= last) {
 			if (!found_old) {
 				oldest = mdb_find_oldest(txn);
-				env->me_pgoldest = oldest;
 				found_old = 1;
 			}
 			if (oldest <= last)
@@ -2034,7 +2864,6 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 		if (oldest <= last) {
 			if (!found_old) {
 				oldest = mdb_find_oldest(txn);
-				env->me_pgoldest = oldest;
 				found_old = 1;
 			}
 			if (oldest <= last)
@@ -2046,7 +2875,8 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 			return rc;
 
 		idl = (MDB_ID *) data.mv_data;
-		i = idl[0];
+		i = mdb_midl_count(idl);
+		MDB_METRIC(env, freedb_reads, 1);
 		if (!mop) {
 			if (!(env->me_pghead = mop = mdb_midl_alloc(i))) {
 				rc = ENOMEM;
@@ -2059,14 +2889,16 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 		}
 		env->me_pglast = last;
 #if (MDB_DEBUG) > 1
-		DPRINTF(("IDL read txn %"Z"u root %"Z"u num %u",
-			last, txn->mt_dbs[FREE_DBI].md_root, i));
-		for (j = i; j; j--)
+		DPRINTF(("IDL read txn %"Z"u root %"Z"u num %u%s",
+			last, txn->mt_dbs[FREE_DBI].md_root, i,
+			MDB_IDL_IS_RANGES(idl) ? " in ranges" : ""));
+		for (j = MDB_IDL_IS_RANGES(idl) ? MDB_IDL_NRANGES(idl) * 2 : i; j; j--)
 			DPRINTF(("IDL %"Z"u", idl[j]));
 #endif
 		/* Merge in descending sorted order */
 		mdb_midl_xmerge(mop, idl);
 		mop_len = mop[0];
+		merged = num > 1 && mop_len >= MDB_PGRUNS_MIN;
 	}
 
 	/* Use new pages from the map when nothing suitable in the freeDB */
@@ -2088,16 +2920,20 @@ search_done:
 		}
 	}
 	if (i) {
+		mdb_pgruns_take(env, i, num);
 		mop[0] = mop_len -= num;
 		/* Move any stragglers down */
 		for (j = i-num; j < mop_len; )
 			mop[++j] = mop[++i];
+		MDB_METRIC(env, alloc_freelist, num);
 	} else {
 		txn->mt_next_pgno = pgno + num;
+		MDB_METRIC(env, alloc_extend, num);
 	}
 	np->mp_pgno = pgno;
 	mdb_page_dirty(txn, np);
 	*mp = np;
+	MDB_PROBE3(page__alloc, pgno, num, i ? 1 : 2);
 
 	return MDB_SUCCESS;
 
@@ -2155,6 +2991,8 @@ mdb_page_unspill(MDB_txn *txn, MDB_page *mp, MDB_page **ret)
 			int num;
 			if (txn->mt_dirty_room == 0)
 				return MDB_TXN_FULL;
+			if (mdb_dlist_grow(txn, txn->mt_u.dirty_list[0].mid + 1))
+				return ENOMEM;
 			if (IS_OVERFLOW(mp))
 				num = mp->mp_pages;
 			else
@@ -2185,6 +3023,7 @@ mdb_page_unspill(MDB_txn *txn, MDB_page *mp, MDB_page **ret)
 
 			mdb_page_dirty(txn, np);
 			np->mp_flags |= P_DIRTY;
+			MDB_METRIC(env, unspill_pages, num);
 			*ret = np;
 			break;
 		}
@@ -2231,31 +3070,31 @@ mdb_page_touch(MDB_cursor *mc)
 			mc->mc_db->md_root = pgno;
 		}
 	} else if (txn->mt_parent && !IS_SUBP(mp)) {
-		MDB_ID2 mid, *dl = txn->mt_u.dirty_list;
+		MDB_ID2 mid;
+		MDB_page *dp;
 		pgno = mp->mp_pgno;
 		/* If txn has a parent, make sure the page is in our
 		 * dirty list.
 		 */
-		if (dl[0].mid) {
-			unsigned x = mdb_mid2l_search(dl, pgno);
-			if (x <= dl[0].mid && dl[x].mid == pgno) {
-				if (mp != dl[x].mptr) { /* bad cursor? */
-					mc->mc_flags &= ~(C_INITIALIZED|C_EOF);
-					txn->mt_flags |= MDB_TXN_ERROR;
-					return MDB_CORRUPTED;
-				}
-				return 0;
+		if ((dp = mdb_dlist_find(txn, pgno)) != NULL) {
+			if (mp != dp) { /* bad cursor? */
+				mc->mc_flags &= ~(C_INITIALIZED|C_EOF);
+				txn->mt_flags |= MDB_TXN_ERROR;
+				return MDB_CORRUPTED;
 			}
+			return 0;
 		}
-		mdb_cassert(mc, dl[0].mid < MDB_IDL_UM_MAX);
 		/* No - copy it */
+		if ((rc = mdb_dlist_grow(txn, txn->mt_u.dirty_list[0].mid + 1)))
+			return rc;
 		np = mdb_page_malloc(txn, 1);
 		if (!np)
 			return ENOMEM;
 		mid.mid = pgno;
 		mid.mptr = np;
-		rc = mdb_mid2l_insert(dl, &mid);
+		rc = mdb_mid2l_insert(txn->mt_u.dirty_list, &mid);
 		mdb_cassert(mc, rc == 0);
+		mdb_dhash_add(txn, &mid);
 	} else {
 		return 0;
 	}
@@ -2320,32 +3159,172 @@ mdb_env_sync(MDB_env *env, int force)
 	return rc;
 }
 
-/** Back up parent txn's cursors, then grab the originals for tracking */
-static int
-mdb_cursor_shadow(MDB_txn *src, MDB_txn *dst)
+#ifdef MDB_USE_FUTEX
+/** Return the futex word of the shared last txnid: its low 32 bits. */
+static uint32_t *
+mdb_txnid_futex(MDB_env *env)
 {
-	MDB_cursor *mc, *bk;
-	MDB_xcursor *mx;
-	size_t size;
-	int i;
+	uint32_t *ptr = (uint32_t *)&env->me_txns->mti_txnid;
+#if BYTE_ORDER == BIG_ENDIAN
+	if (sizeof(txnid_t) > sizeof(uint32_t))
+		ptr++;
+#endif
+	return ptr;
+}
+#endif
 
-	for (i = src->mt_numdbs; --i >= 0; ) {
-		if ((mc = src->mt_cursors[i]) != NULL) {
-			size = sizeof(MDB_cursor);
-			if (mc->mc_xcursor)
-				size += sizeof(MDB_xcursor);
-			for (; mc; mc = bk->mc_next) {
-				bk = malloc(size);
-				if (!bk)
-					return ENOMEM;
-				*bk = *mc;
-				mc->mc_backup = bk;
-				mc->mc_db = &dst->mt_dbs[i];
-				/* Kill pointers into src - and dst to reduce abuse: The
-				 * user may not use mc until dst ends. Otherwise we'd...
-				 */
-				mc->mc_txn    = NULL;	/* ...set this to dst */
-				mc->mc_dbflag = NULL;	/* ...and &dst->mt_dbflags[i] */
+/** Wake up processes blocked in #mdb_env_wait_commit().
+ *	Called after a commit released the writer lock.
+ */
+static void
+mdb_env_notify(MDB_env *env)
+{
+#ifdef MDB_USE_FUTEX
+	/* Pairs with the barrier in #mdb_env_wait_commit(): either the
+	 * waiter sees the new txnid, or we see the waiter.
+	 */
+	__sync_synchronize();
+	if (env->me_txns->mti_waiters)
+		syscall(SYS_futex, mdb_txnid_futex(env), FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#else
+	(void)env;
+#endif
+}
+
+/** Return the ID of the last committed transaction. */
+static txnid_t
+mdb_env_last_txnid(MDB_env *env)
+{
+	if (env->me_txns)
+		return *(volatile txnid_t *)&env->me_txns->mti_txnid;
+	return env->me_metas[mdb_env_pick_meta(env)]->mm_txnid;
+}
+
+/** Return a monotonic clock reading in microseconds. */
+static uint64_t
+mdb_clock_usec(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, now;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return now.QuadPart / freq.QuadPart * 1000000 +
+		now.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/** Return a monotonic clock reading in milliseconds. */
+static uint64_t
+mdb_clock_msec(void)
+{
+	return mdb_clock_usec() / 1000;
+}
+
+int
+mdb_env_wait_commit(MDB_env *env, size_t txnid, unsigned int msec, size_t *last)
+{
+	uint64_t now, deadline;
+	txnid_t cur;
+	int rc = 0;
+
+	if (!env || !env->me_map)
+		return EINVAL;
+
+	now = mdb_clock_msec();
+	deadline = msec == MDB_WAIT_FOREVER ? UINT64_MAX : now + msec;
+
+#ifdef MDB_USE_FUTEX
+	if (env->me_txns) {
+		uint32_t *word = mdb_txnid_futex(env);
+		__sync_fetch_and_add(&env->me_txns->mti_waiters, 1);
+		while ((cur = mdb_env_last_txnid(env)) <= txnid) {
+			struct timespec ts, *tp = NULL;
+			if (msec != MDB_WAIT_FOREVER) {
+				if (now >= deadline) {
+					rc = ETIMEDOUT;
+					break;
+				}
+				ts.tv_sec = (deadline - now) / 1000;
+				ts.tv_nsec = ((deadline - now) % 1000) * 1000000;
+				tp = &ts;
+			}
+			if (syscall(SYS_futex, word, FUTEX_WAIT, (uint32_t)cur, tp, NULL, 0) &&
+				errno == EINTR) {
+				rc = EINTR;
+				break;
+			}
+			now = mdb_clock_msec();
+		}
+		__sync_fetch_and_sub(&env->me_txns->mti_waiters, 1);
+		if (last)
+			*last = mdb_env_last_txnid(env);
+		return rc;
+	}
+#endif
+
+	/* No shared futex: poll the meta pages with a capped backoff */
+	{
+		unsigned int delay = 1;
+		while ((cur = mdb_env_last_txnid(env)) <= txnid) {
+			if (now >= deadline) {
+				rc = ETIMEDOUT;
+				break;
+			}
+			if (delay > deadline - now)
+				delay = deadline - now;
+#ifdef _WIN32
+			Sleep(delay);
+#else
+			{
+				struct timespec ts;
+				ts.tv_sec = delay / 1000;
+				ts.tv_nsec = (delay % 1000) * 1000000;
+				if (nanosleep(&ts, NULL) && errno == EINTR) {
+					rc = EINTR;
+					break;
+				}
+			}
+#endif
+			if (delay < 16)
+				delay <<= 1;
+			now = mdb_clock_msec();
+		}
+	}
+	if (last)
+		*last = mdb_env_last_txnid(env);
+	return rc;
+}
+
+/** Back up parent txn's cursors, then grab the originals for tracking */
+static int
+mdb_cursor_shadow(MDB_txn *src, MDB_txn *dst)
+{
+	MDB_cursor *mc, *bk;
+	MDB_xcursor *mx;
+	size_t size;
+	int i;
+
+	for (i = src->mt_numdbs; --i >= 0; ) {
+		if ((mc = src->mt_cursors[i]) != NULL) {
+			size = sizeof(MDB_cursor);
+			if (mc->mc_xcursor)
+				size += sizeof(MDB_xcursor);
+			for (; mc; mc = bk->mc_next) {
+				bk = malloc(size);
+				if (!bk)
+					return ENOMEM;
+				*bk = *mc;
+				mc->mc_backup = bk;
+				mc->mc_db = &dst->mt_dbs[i];
+				/* Kill pointers into src - and dst to reduce abuse: The
+				 * user may not use mc until dst ends. Otherwise we'd...
+				 */
+				mc->mc_txn    = NULL;	/* ...set this to dst */
+				mc->mc_dbflag = NULL;	/* ...and &dst->mt_dbflags[i] */
 				if ((mx = mc->mc_xcursor) != NULL) {
 					*(MDB_xcursor *)(bk+1) = *mx;
 					mx->mx_cursor.mc_txn = NULL; /* ...and dst. */
@@ -2528,7 +3507,9 @@ mdb_txn_renew0(MDB_txn *txn)
 		}
 	} else {
 		if (ti) {
+			MDB_PROBE1(wmutex__acquire, env);
 			LOCK_MUTEX_W(env);
+			MDB_PROBE1(wmutex__acquired, env);
 
 			txn->mt_txnid = ti->mti_txnid;
 			meta = env->me_metas[txn->mt_txnid & 1];
@@ -2541,9 +3522,12 @@ mdb_txn_renew0(MDB_txn *txn)
 		if (txn->mt_txnid == mdb_debug_start)
 			mdb_debug = 1;
 #endif
-		txn->mt_dirty_room = MDB_IDL_UM_MAX;
+		txn->mt_dirty_room = env->me_maxdirty;
+		env->me_pgoldest_next = 0;
+		txn->mt_dirty_cap = env->me_dirty_cap;
 		txn->mt_u.dirty_list = env->me_dirty_list;
 		txn->mt_u.dirty_list[0].mid = 0;
+		txn->mt_dhash.dh_valid = 0;
 		txn->mt_free_pgs = env->me_free_pgs;
 		txn->mt_free_pgs[0] = 0;
 		txn->mt_spill_pgs = NULL;
@@ -2658,7 +3642,9 @@ mdb_txn_begin(MDB_env *env, MDB_txn *parent, unsigned int flags, MDB_txn **ret)
 ok:
 	if (parent) {
 		unsigned int i;
-		txn->mt_u.dirty_list = malloc(sizeof(MDB_ID2)*MDB_IDL_UM_SIZE);
+		txn->mt_dirty_cap = MDB_DIRTY_INIT < env->me_maxdirty ?
+			MDB_DIRTY_INIT : env->me_maxdirty;
+		txn->mt_u.dirty_list = malloc(sizeof(MDB_ID2) * (txn->mt_dirty_cap + 1));
 		if (!txn->mt_u.dirty_list ||
 			!(txn->mt_free_pgs = mdb_midl_alloc(MDB_IDL_UM_MAX)))
 		{
@@ -2703,6 +3689,7 @@ ok:
 			free(txn);
 	} else {
 		*ret = txn;
+		MDB_PROBE3(txn__begin, txn, txn->mt_txnid, (txn->mt_flags & MDB_TXN_RDONLY) != 0);
 		DPRINTF(("begin txn %"Z"u%c %p on mdbenv %p, root page %"Z"u",
 			txn->mt_txnid, (txn->mt_flags & MDB_TXN_RDONLY) ? 'r' : 'w',
 			(void *) txn, (void *) env, txn->mt_dbs[MAIN_DBI].md_root));
@@ -2779,6 +3766,8 @@ mdb_txn_reset0(MDB_txn *txn, const char *act)
 			mdb_dlist_free(txn);
 		}
 		mdb_midl_free(env->me_pghead);
+		env->me_pgruns.mr_mop = NULL;
+		env->me_pgruns.mr_scanned = 0;
 
 		if (txn->mt_parent) {
 			txn->mt_parent->mt_child = NULL;
@@ -2786,9 +3775,11 @@ mdb_txn_reset0(MDB_txn *txn, const char *act)
 			mdb_midl_free(txn->mt_free_pgs);
 			mdb_midl_free(txn->mt_spill_pgs);
 			free(txn->mt_u.dirty_list);
+			free(txn->mt_dhash.dh_tab);
 			return;
 		}
 
+		mdb_arena_reset(env);
 		if (mdb_midl_shrink(&txn->mt_free_pgs))
 			env->me_free_pgs = txn->mt_free_pgs;
 		env->me_pghead = NULL;
@@ -2796,8 +3787,10 @@ mdb_txn_reset0(MDB_txn *txn, const char *act)
 
 		env->me_txn = NULL;
 		/* The writer mutex was locked in mdb_txn_begin. */
-		if (env->me_txns)
+		if (env->me_txns) {
 			UNLOCK_MUTEX_W(env);
+			MDB_PROBE1(wmutex__release, env);
+		}
 	}
 }
 
@@ -2820,6 +3813,7 @@ mdb_txn_abort(MDB_txn *txn)
 	if (txn == NULL)
 		return;
 
+	MDB_PROBE2(txn__abort, txn, txn->mt_txnid);
 	if (txn->mt_child)
 		mdb_txn_abort(txn->mt_child);
 
@@ -2848,6 +3842,8 @@ mdb_freelist_save(MDB_txn *txn)
 	txnid_t	pglast = 0, head_id = 0;
 	pgno_t	freecnt = 0, *free_pgs, *mop;
 	ssize_t	head_room = 0, total_room = 0, mop_len, clean_limit;
+	unsigned ranges = 0;
+	int rle = -1;	/* save me_pghead as ranges, once decided */
 
 	mdb_cursor_init(&mc, txn, FREE_DBI, NULL);
 
@@ -2911,14 +3907,31 @@ mdb_freelist_save(MDB_txn *txn)
 			do {
 				freecnt = free_pgs[0];
 				data.mv_size = MDB_IDL_SIZEOF(free_pgs);
+				if (env->me_flags & MDB_FREERANGES) {
+					/* Store ranges if that is smaller */
+					mdb_midl_sort(free_pgs);
+					ranges = mdb_midl_ranges(free_pgs);
+					if (2 * ranges < freecnt)
+						data.mv_size = (2 * ranges + 1) * sizeof(MDB_ID);
+					else
+						ranges = 0;
+				}
 				rc = mdb_cursor_put(&mc, &key, &data, MDB_RESERVE);
 				if (rc)
 					return rc;
 				/* Retry if mt_free_pgs[] grew during the Put() */
 				free_pgs = txn->mt_free_pgs;
 			} while (freecnt < free_pgs[0]);
-			mdb_midl_sort(free_pgs);
-			memcpy(data.mv_data, free_pgs, data.mv_size);
+			if (ranges) {
+				mdb_midl_encode_ranges(free_pgs, data.mv_data);
+				txn->mt_flags |= MDB_TXN_RANGES;
+			} else {
+				if (!(env->me_flags & MDB_FREERANGES))
+					mdb_midl_sort(free_pgs);
+				memcpy(data.mv_data, free_pgs, data.mv_size);
+			}
+			MDB_METRIC(env, freelist_records, 1);
+			MDB_METRIC(env, freelist_pages, free_pgs[0]);
 #if (MDB_DEBUG) > 1
 			{
 				unsigned int i = free_pgs[0];
@@ -2933,6 +3946,13 @@ mdb_freelist_save(MDB_txn *txn)
 
 		mop = env->me_pghead;
 		mop_len = (mop ? mop[0] : 0) + txn->mt_loose_count;
+		if (rle < 0)
+			rle = (env->me_flags & MDB_FREERANGES) && mop &&
+				2 * (mdb_midl_ranges(mop) + txn->mt_loose_count) < (size_t)mop_len;
+		if (rle > 0) {
+			/* Room for the ranges, each loose page may add one */
+			mop_len = 2 * (mdb_midl_ranges(mop) + txn->mt_loose_count);
+		}
 
 		/* Reserve records for me_pghead[]. Split it if multi-page,
 		 * to avoid searching freeDB for a page range. Use keys in
@@ -2947,7 +3967,7 @@ mdb_freelist_save(MDB_txn *txn)
 			head_room = 0;
 		}
 		/* (Re)write {key = head_id, IDL length = head_room} */
-		total_room -= head_room;
+		total_room -= rle > 0 ? head_room & ~(ssize_t)1 : head_room;
 		head_room = mop_len - total_room;
 		if (head_room > maxfree_1pg && head_id > 1) {
 			/* Overflow multi-page for part of me_pghead */
@@ -2969,7 +3989,8 @@ mdb_freelist_save(MDB_txn *txn)
 		do {
 			pgs[j] = 0;
 		} while (--j >= 0);
-		total_room += head_room;
+		/* Ranges take two slots, an odd one is left unused */
+		total_room += rle > 0 ? head_room & ~(ssize_t)1 : head_room;
 	}
 
 	/* Return loose page numbers to me_pghead, though usually none are
@@ -2996,7 +4017,42 @@ mdb_freelist_save(MDB_txn *txn)
 
 	/* Fill in the reserved me_pghead records */
 	rc = MDB_SUCCESS;
-	if (mop_len) {
+	if (rle > 0 && mop_len) {
+		MDB_val key, data;
+		MDB_IDL rl;
+		ssize_t pairs = mdb_midl_ranges(mop);
+
+		if (!(rl = mdb_midl_alloc(2 * pairs)))
+			return ENOMEM;
+		mdb_midl_encode_ranges(mop, rl);
+		/* Like below, but handing out pairs from the lowest ranges */
+		rc = mdb_cursor_first(&mc, &key, &data);
+		for (; !rc; rc = mdb_cursor_next(&mc, &key, &data, MDB_NEXT)) {
+			txnid_t id = *(txnid_t *)key.mv_data;
+			ssize_t	len = (ssize_t)(data.mv_size / sizeof(MDB_ID)) - 1;
+			MDB_ID save, *hdr;
+
+			mdb_tassert(txn, len >= 0 && id <= env->me_pglast);
+			key.mv_data = &id;
+			len /= 2;
+			if (len > pairs)
+				len = pairs;
+			pairs -= len;
+			hdr = rl + 2 * pairs;
+			data.mv_size = (2 * len + 1) * sizeof(MDB_ID);
+			data.mv_data = hdr;
+			save = hdr[0];
+			hdr[0] = len | MDB_IDL_RANGES;
+			txn->mt_flags |= MDB_TXN_RANGES;
+			rc = mdb_cursor_put(&mc, &key, &data, MDB_CURRENT);
+			MDB_METRIC(env, freelist_records, 1);
+			MDB_METRIC(env, freelist_pages, mdb_midl_count(hdr));
+			hdr[0] = save;
+			if (rc || !pairs)
+				break;
+		}
+		mdb_midl_free(rl);
+	} else if (mop_len) {
 		MDB_val key, data;
 
 		mop += mop_len;
@@ -3017,6 +4073,8 @@ mdb_freelist_save(MDB_txn *txn)
 			mop[0] = len;
 			rc = mdb_cursor_put(&mc, &key, &data, MDB_CURRENT);
 			mop[0] = save;
+			MDB_METRIC(env, freelist_records, 1);
+			MDB_METRIC(env, freelist_pages, len);
 			if (rc || !(mop_len -= len))
 				break;
 		}
@@ -3024,13 +4082,463 @@ mdb_freelist_save(MDB_txn *txn)
 	return rc;
 }
 
+#if MDB_USE_IOURING
+/** Set up the io_uring of an environment.
+ * @param[in] env the environment handle
+ * @return 0 on success, non-zero if io_uring cannot be used.
+ */
+static int ESECT
+mdb_uring_open(MDB_env *env)
+{
+	MDB_uring *ring = &env->me_uring;
+	struct io_uring_params p;
+	size_t sqsize, cqsize;
+	unsigned i;
+	void *sqes;
+	int fd, rc;
+
+	memset(&p, 0, sizeof(p));
+	fd = syscall(__NR_io_uring_setup, MDB_URING_ENTRIES, &p);
+	if (fd < 0)
+		return ErrCode();
+	if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+		close(fd);
+		return ENOSYS;
+	}
+	sqsize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	cqsize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	ring->mu_mapsize = sqsize > cqsize ? sqsize : cqsize;
+	ring->mu_map = mmap(NULL, ring->mu_mapsize, PROT_READ|PROT_WRITE,
+		MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (ring->mu_map == MAP_FAILED)
+		goto fail;
+	sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+		PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		rc = ErrCode();
+		munmap(ring->mu_map, ring->mu_mapsize);
+		close(fd);
+		return rc;
+	}
+	ring->mu_fd = fd;
+	ring->mu_sqes = sqes;
+	ring->mu_sqentries = p.sq_entries;
+	ring->mu_sqmask = *(unsigned *)(ring->mu_map + p.sq_off.ring_mask);
+	ring->mu_sqtail = (unsigned *)(ring->mu_map + p.sq_off.tail);
+	ring->mu_cqes = (struct io_uring_cqe *)(ring->mu_map + p.cq_off.cqes);
+	ring->mu_cqentries = p.cq_entries;
+	ring->mu_cqmask = *(unsigned *)(ring->mu_map + p.cq_off.ring_mask);
+	ring->mu_cqhead = (unsigned *)(ring->mu_map + p.cq_off.head);
+	ring->mu_cqtail = (unsigned *)(ring->mu_map + p.cq_off.tail);
+	/* Entries are always submitted in order */
+	for (i = 0; i < p.sq_entries; i++)
+		((unsigned *)(ring->mu_map + p.sq_off.array))[i] = i;
+	return MDB_SUCCESS;
+
+fail:
+	rc = ErrCode();
+	close(fd);
+	return rc;
+}
+
+/** Release the mappings and the descriptor of a ring, and mark it
+ *	unavailable. Entries still queued are dropped with it.
+ * @param[in] ring the ring
+ */
+static void ESECT
+mdb_uring_drop(MDB_uring *ring)
+{
+	if (ring->mu_state > 0) {
+		munmap(ring->mu_sqes, ring->mu_sqentries * sizeof(struct io_uring_sqe));
+		munmap(ring->mu_map, ring->mu_mapsize);
+		close(ring->mu_fd);
+	}
+	ring->mu_state = -1;
+	ring->mu_pending = ring->mu_inflight = 0;
+	ring->mu_err = 0;
+}
+
+/** Release the io_uring of an environment */
+static void ESECT
+mdb_uring_close(MDB_env *env)
+{
+	mdb_uring_drop(&env->me_uring);
+	free(env->me_uring.mu_iov);
+}
+
+/** Get the ring for a flush of up to \b num pages, setting it up
+ * on first use.
+ * @return the ring, or NULL to flush with pwritev().
+ */
+static MDB_uring *
+mdb_uring_get(MDB_env *env, size_t num)
+{
+	MDB_uring *ring = &env->me_uring;
+
+	if (!ring->mu_state) {
+		int rc = mdb_uring_open(env);
+		DPRINTF(("io_uring: %s", rc ? mdb_strerror(rc) : "ready"));
+		ring->mu_state = rc ? -1 : 1;
+	}
+	if (ring->mu_state < 0)
+		return NULL;
+	if (ring->mu_iovcap < num) {
+		struct iovec *iov = realloc(ring->mu_iov, num * sizeof(struct iovec));
+		if (!iov)
+			return NULL;
+		ring->mu_iov = iov;
+		ring->mu_iovcap = num;
+	}
+	return ring;
+}
+
+/** Reap the completions of a ring.
+ *	Errors of the operations themselves are kept in mu_err.
+ * @param[in] ring the ring
+ */
+static void
+mdb_uring_reap(MDB_uring *ring)
+{
+	struct io_uring_cqe *cqe;
+	unsigned head, tail;
+
+	head = *ring->mu_cqhead;
+	tail = __atomic_load_n(ring->mu_cqtail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++) {
+		cqe = &ring->mu_cqes[head & ring->mu_cqmask];
+		/* user_data holds the result expected */
+		if (!ring->mu_err) {
+			if (cqe->res < 0)
+				ring->mu_err = -cqe->res;
+			else if ((__u64)cqe->res != cqe->user_data)
+				ring->mu_err = EIO;
+		}
+		ring->mu_inflight--;
+	}
+	__atomic_store_n(ring->mu_cqhead, head, __ATOMIC_RELEASE);
+}
+
+/** Submit the queued entries of a ring and reap its completions.
+ *	The call may submit or reap nothing, callers loop until the ring
+ *	has room or is idle. A failed ring keeps its entries, for
+ *	#mdb_uring_fail().
+ * @param[in] ring the ring
+ * @param[in] wait the number of completions to wait for
+ * @return 0 on success, non-zero if the ring failed.
+ */
+static int
+mdb_uring_enter(MDB_uring *ring, unsigned wait)
+{
+	int rc;
+
+	rc = syscall(__NR_io_uring_enter, ring->mu_fd, ring->mu_pending,
+		wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	if (rc < 0) {
+		rc = ErrCode();
+		/* Out of memory or of room for completions: reaping frees some */
+		if (rc != EINTR && rc != EAGAIN && rc != EBUSY) {
+			DPRINTF(("io_uring_enter: %s", strerror(rc)));
+			return rc;
+		}
+	} else {
+		ring->mu_pending -= rc;
+		ring->mu_inflight += rc;
+	}
+	mdb_uring_reap(ring);
+	return MDB_SUCCESS;
+}
+
+/** Queue an operation on a ring, submitting the queue first if it
+ *	is full. Its completions must also fit in the completion queue.
+ * @param[in] ring the ring
+ * @param[in] op the IORING_OP_ opcode
+ * @param[in] fd the file
+ * @param[in] iov the iovecs of a write, NULL for a sync
+ * @param[in] n the number of iovecs
+ * @param[in] pos the offset to write at
+ * @param[in] size the bytes to write
+ * @return 0 on success, non-zero if the ring failed.
+ */
+static int
+mdb_uring_queue(MDB_uring *ring, int op, int fd, struct iovec *iov,
+	unsigned n, off_t pos, size_t size)
+{
+	struct io_uring_sqe *sqe;
+	unsigned tail;
+	int rc;
+
+	while (ring->mu_pending == ring->mu_sqentries ||
+		ring->mu_pending + ring->mu_inflight >= ring->mu_cqentries) {
+		if ((rc = mdb_uring_enter(ring, 1)))
+			return rc;
+	}
+	tail = *ring->mu_sqtail;
+	sqe = &ring->mu_sqes[tail & ring->mu_sqmask];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = op;
+	sqe->fd = fd;
+	if (op == IORING_OP_WRITEV) {
+		sqe->addr = (uintptr_t)iov;
+		sqe->len = n;
+		sqe->off = pos;
+	} else {
+		/* Start the sync only after all the writes before it */
+		sqe->flags = IOSQE_IO_DRAIN;
+		sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+	}
+	sqe->user_data = size;
+	__atomic_store_n(ring->mu_sqtail, tail + 1, __ATOMIC_RELEASE);
+	ring->mu_pending++;
+	return MDB_SUCCESS;
+}
+
+/** Submit everything queued on a ring and wait until it completes.
+ * @param[in] ring the ring
+ * @return 0 on success, else the error of the ring, which then still
+ * has entries, or the first error of the operations.
+ */
+static int
+mdb_uring_wait(MDB_uring *ring)
+{
+	int rc = MDB_SUCCESS;
+
+	while (ring->mu_pending || ring->mu_inflight) {
+		if ((rc = mdb_uring_enter(ring, ring->mu_pending + ring->mu_inflight)))
+			break;
+	}
+	if (!rc)
+		rc = ring->mu_err;
+	ring->mu_err = 0;
+	return rc;
+}
+
+/** Tear down the ring of an environment after it failed, so that later
+ *	flushes use pwritev(). The writes in flight are waited for first,
+ *	since their pages are reused once the txn ends. If even that fails,
+ *	the environment gets #MDB_FATAL_ERROR.
+ * @param[in] env the environment handle
+ */
+static void ESECT
+mdb_uring_fail(MDB_env *env)
+{
+	MDB_uring *ring = &env->me_uring;
+	int rc;
+
+	while (ring->mu_inflight) {
+		rc = syscall(__NR_io_uring_enter, ring->mu_fd, 0,
+			ring->mu_inflight, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (rc < 0) {
+			rc = ErrCode();
+			if (rc != EINTR && rc != EAGAIN && rc != EBUSY) {
+				DPRINTF(("io_uring writes lost: %s", strerror(rc)));
+				env->me_flags |= MDB_FATAL_ERROR;
+				break;
+			}
+		}
+		mdb_uring_reap(ring);
+	}
+	mdb_uring_drop(ring);
+}
+#endif
+
+#if MDB_USE_WRITERS
+/** Write a run of the dirty list of a flush, as #mdb_page_flush() does.
+ * @param[in] env the environment
+ * @param[in] dl the dirty list
+ * @param[in,out] ws the run, with its counters
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_wseg_write(MDB_env *env, MDB_ID2L dl, MDB_wseg *ws)
+{
+	unsigned	psize = env->me_psize;
+	struct iovec iov[MDB_COMMIT_PAGES];
+	MDB_page	*dp = NULL;
+	size_t		size = 0, pos = 0, wsize = 0;
+	size_t		next_pos = 1; /* impossible pos, so pos != next_pos */
+	off_t		wpos = 0;
+	ssize_t		wres;
+	int			i, n = 0;
+
+	for (i = ws->ws_lo; ; i++) {
+		if (i < ws->ws_hi) {
+			dp = dl[i].mptr;
+			/* Don't flush this page yet */
+			if (dp->mp_flags & (P_LOOSE|P_KEEP)) {
+				dp->mp_flags &= ~P_KEEP;
+				dl[i].mid = 0;
+				continue;
+			}
+			dp->mp_flags &= ~P_DIRTY;
+			pos = dl[i].mid * psize;
+			size = psize;
+			if (IS_OVERFLOW(dp)) size *= dp->mp_pages;
+			ws->ws_bytes += size;
+		}
+		if (i >= ws->ws_hi || pos != next_pos || n == MDB_COMMIT_PAGES ||
+			wsize + size > MAX_WRITE) {
+			if (n) {
+				wres = pwritev(env->me_fd, iov, n, wpos);
+				if (wres != (ssize_t)wsize)
+					return wres < 0 ? ErrCode() : EIO;
+				ws->ws_writes++;
+				n = 0;
+			}
+			if (i >= ws->ws_hi)
+				break;
+			wpos = pos;
+			wsize = 0;
+		}
+		next_pos = pos + size;
+		iov[n].iov_len = size;
+		iov[n].iov_base = (char *)dp;
+		wsize += size;
+		n++;
+	}
+	return MDB_SUCCESS;
+}
+
+	/** Claim and write runs until none are left. Called with wp_mutex held. */
+static void
+mdb_wpool_work(MDB_env *env, MDB_wpool *wp)
+{
+	MDB_wseg *ws;
+
+	while (wp->wp_next < wp->wp_nsegs) {
+		ws = &wp->wp_segs[wp->wp_next++];
+		pthread_mutex_unlock(&wp->wp_mutex);
+		ws->ws_rc = mdb_wseg_write(env, wp->wp_dl, ws);
+		pthread_mutex_lock(&wp->wp_mutex);
+		if (!--wp->wp_left)
+			pthread_cond_signal(&wp->wp_done);
+	}
+}
+
+	/** Writer thread of a #MDB_wpool */
+static THREAD_RET
+mdb_wpool_thread(void *arg)
+{
+	MDB_env *env = arg;
+	MDB_wpool *wp = env->me_wpool;
+
+	pthread_mutex_lock(&wp->wp_mutex);
+	for (;;) {
+		while (!wp->wp_stop && wp->wp_next >= wp->wp_nsegs)
+			pthread_cond_wait(&wp->wp_cond, &wp->wp_mutex);
+		if (wp->wp_stop)
+			break;
+		mdb_wpool_work(env, wp);
+	}
+	pthread_mutex_unlock(&wp->wp_mutex);
+	return (THREAD_RET)0;
+}
+
+/** Get the writer threads of an environment, starting them if needed.
+ * @return the pool, or NULL if no thread could be started.
+ */
+static MDB_wpool *
+mdb_wpool_get(MDB_env *env)
+{
+	MDB_wpool *wp = env->me_wpool;
+
+	if (wp)
+		return wp->wp_nthreads ? wp : NULL;
+	if ((wp = calloc(1, sizeof(MDB_wpool))) == NULL)
+		return NULL;
+	pthread_mutex_init(&wp->wp_mutex, NULL);
+	pthread_cond_init(&wp->wp_cond, NULL);
+	pthread_cond_init(&wp->wp_done, NULL);
+	env->me_wpool = wp;
+	/* The committing thread is one of the writers */
+	while (wp->wp_nthreads < (int)env->me_writers - 1) {
+		if (THREAD_CREATE(wp->wp_threads[wp->wp_nthreads], mdb_wpool_thread, env))
+			break;
+		wp->wp_nthreads++;
+	}
+	return wp->wp_nthreads ? wp : NULL;
+}
+
+	/** Stop the writer threads of an environment */
+static void
+mdb_wpool_close(MDB_env *env)
+{
+	MDB_wpool *wp = env->me_wpool;
+	int i;
+
+	if (!wp)
+		return;
+	pthread_mutex_lock(&wp->wp_mutex);
+	wp->wp_stop = 1;
+	pthread_cond_broadcast(&wp->wp_cond);
+	pthread_mutex_unlock(&wp->wp_mutex);
+	for (i = 0; i < wp->wp_nthreads; i++)
+		THREAD_FINISH(wp->wp_threads[i]);
+	pthread_cond_destroy(&wp->wp_done);
+	pthread_cond_destroy(&wp->wp_cond);
+	pthread_mutex_destroy(&wp->wp_mutex);
+	free(wp);
+	env->me_wpool = NULL;
+}
+
+/** Write dirty pages from the writer threads, in runs of the sorted list.
+ * @param[in] txn the transaction that's being committed
+ * @param[in] wp the writer threads
+ * @param[in] keep number of initial pages in dirty_list to skip.
+ * @param[in] nsegs number of runs to split the rest into.
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_wpool_flush(MDB_txn *txn, MDB_wpool *wp, int keep, int nsegs)
+{
+	MDB_env		*env = txn->mt_env;
+	MDB_ID2L	dl = txn->mt_u.dirty_list;
+	int			i, count = dl[0].mid - keep, rc = MDB_SUCCESS;
+	size_t		bytes = 0;
+
+	pthread_mutex_lock(&wp->wp_mutex);
+	for (i = 0; i < nsegs; i++) {
+		MDB_wseg *ws = &wp->wp_segs[i];
+		ws->ws_lo = keep + 1 + (int)((size_t)count * i / nsegs);
+		ws->ws_hi = keep + 1 + (int)((size_t)count * (i+1) / nsegs);
+		ws->ws_rc = MDB_SUCCESS;
+		ws->ws_bytes = ws->ws_writes = 0;
+	}
+	wp->wp_dl = dl;
+	wp->wp_nsegs = nsegs;
+	wp->wp_next = 0;
+	wp->wp_left = nsegs;
+	pthread_cond_broadcast(&wp->wp_cond);
+	mdb_wpool_work(env, wp);
+	while (wp->wp_left)
+		pthread_cond_wait(&wp->wp_done, &wp->wp_mutex);
+	wp->wp_nsegs = wp->wp_next = 0;
+	pthread_mutex_unlock(&wp->wp_mutex);
+
+	for (i = 0; i < nsegs; i++) {
+		MDB_wseg *ws = &wp->wp_segs[i];
+		if (ws->ws_rc && !rc)
+			rc = ws->ws_rc;
+		bytes += ws->ws_bytes;
+		MDB_METRIC(env, flush_writes, ws->ws_writes);
+	}
+	MDB_METRIC(env, flush_pages, bytes / env->me_psize);
+	MDB_METRIC(env, flush_bytes, bytes);
+	MDB_METRIC(env, writer_flushes, 1);
+	if (rc)
+		DPRINTF(("Write error: %s", strerror(rc)));
+	return rc;
+}
+#endif
+
 /** Flush (some) dirty pages to the map, after clearing their dirty flag.
  * @param[in] txn the transaction that's being committed
  * @param[in] keep number of initial pages in dirty_list to keep dirty.
+ * @param[out] synced if not NULL, the flush may also sync the data file
+ * when it submits the writes through io_uring, and then sets this.
  * @return 0 on success, non-zero on failure.
  */
 static int
-mdb_page_flush(MDB_txn *txn, int keep)
+mdb_page_flush(MDB_txn *txn, int keep, int *synced)
 {
 	MDB_env		*env = txn->mt_env;
 	MDB_ID2L	dl = txn->mt_u.dirty_list;
@@ -3042,13 +4550,21 @@ mdb_page_flush(MDB_txn *txn, int keep)
 #ifdef _WIN32
 	OVERLAPPED	ov;
 #else
-	struct iovec iov[MDB_COMMIT_PAGES];
+	struct iovec iovs[MDB_COMMIT_PAGES], *iov = iovs;
 	ssize_t		wpos = 0, wsize = 0, wres;
 	size_t		next_pos = 1; /* impossible pos, so pos != next_pos */
 	int			n = 0;
 #endif
+#if MDB_USE_IOURING
+	MDB_uring	*ring = NULL;
+#endif
+#if MDB_USE_WRITERS
+	MDB_wpool	*wp;
+	int			nsegs;
+#endif
 
 	j = i = keep;
+	MDB_PROBE2(page__flush, txn, pagecount - keep);
 
 	if (env->me_flags & MDB_WRITEMAP) {
 		/* Clear dirty flags */
@@ -3061,10 +4577,32 @@ mdb_page_flush(MDB_txn *txn, int keep)
 				continue;
 			}
 			dp->mp_flags &= ~P_DIRTY;
+			size = IS_OVERFLOW(dp) ? dp->mp_pages : 1;
+			MDB_METRIC(env, flush_pages, size);
+			MDB_METRIC(env, flush_bytes, size * psize);
 		}
 		goto done;
 	}
 
+#if MDB_USE_WRITERS
+	/* Split a large flush between the writer threads */
+	nsegs = (pagecount - keep) / MDB_WRITER_PAGES;
+	if (nsegs > (int)env->me_writers)
+		nsegs = env->me_writers;
+	if (nsegs > 1 && (wp = mdb_wpool_get(env))) {
+		if ((rc = mdb_wpool_flush(txn, wp, keep, nsegs)))
+			return rc;
+		goto written;
+	}
+#endif
+
+#if MDB_USE_IOURING
+	/* Queue all the writes at once, each with iovecs of its own */
+	if ((env->me_flags & MDB_IOURING) &&
+		(ring = mdb_uring_get(env, pagecount - keep)))
+		iov = ring->mu_iov;
+#endif
+
 	/* Write the pages */
 	for (;;) {
 		if (++i <= pagecount) {
@@ -3081,6 +4619,8 @@ mdb_page_flush(MDB_txn *txn, int keep)
 			pos = pgno * psize;
 			size = psize;
 			if (IS_OVERFLOW(dp)) size *= dp->mp_pages;
+			MDB_METRIC(env, flush_pages, size / psize);
+			MDB_METRIC(env, flush_bytes, size);
 		}
 #ifdef _WIN32
 		else break;
@@ -3101,35 +4641,50 @@ mdb_page_flush(MDB_txn *txn, int keep)
 			DPRINTF(("WriteFile: %d", rc));
 			return rc;
 		}
+		MDB_METRIC(env, flush_writes, 1);
 #else
 		/* Write up to MDB_COMMIT_PAGES dirty pages at a time. */
 		if (pos!=next_pos || n==MDB_COMMIT_PAGES || wsize+size>MAX_WRITE) {
 			if (n) {
 				/* Write previous page(s) */
-#ifdef MDB_USE_PWRITEV
-				wres = pwritev(env->me_fd, iov, n, wpos);
-#else
-				if (n == 1) {
-					wres = pwrite(env->me_fd, iov[0].iov_base, wsize, wpos);
-				} else {
-					if (lseek(env->me_fd, wpos, SEEK_SET) == -1) {
-						rc = ErrCode();
-						DPRINTF(("lseek: %s", strerror(rc)));
+#if MDB_USE_IOURING
+				if (ring) {
+					rc = mdb_uring_queue(ring, IORING_OP_WRITEV, env->me_fd,
+						iov, n, wpos, wsize);
+					if (rc) {
+						mdb_uring_fail(env);
 						return rc;
 					}
-					wres = writev(env->me_fd, iov, n);
-				}
+					iov += n;
+				} else
 #endif
-				if (wres != wsize) {
-					if (wres < 0) {
-						rc = ErrCode();
-						DPRINTF(("Write error: %s", strerror(rc)));
+				{
+#ifdef MDB_USE_PWRITEV
+					wres = pwritev(env->me_fd, iov, n, wpos);
+#else
+					if (n == 1) {
+						wres = pwrite(env->me_fd, iov[0].iov_base, wsize, wpos);
 					} else {
-						rc = EIO; /* TODO: Use which error code? */
-						DPUTS("short write, filesystem full?");
+						if (lseek(env->me_fd, wpos, SEEK_SET) == -1) {
+							rc = ErrCode();
+							DPRINTF(("lseek: %s", strerror(rc)));
+							return rc;
+						}
+						wres = writev(env->me_fd, iov, n);
+					}
+#endif
+					if (wres != wsize) {
+						if (wres < 0) {
+							rc = ErrCode();
+							DPRINTF(("Write error: %s", strerror(rc)));
+						} else {
+							rc = EIO; /* TODO: Use which error code? */
+							DPUTS("short write, filesystem full?");
+						}
+						return rc;
 					}
-					return rc;
 				}
+				MDB_METRIC(env, flush_writes, 1);
 				n = 0;
 			}
 			if (i > pagecount)
@@ -3146,6 +4701,29 @@ mdb_page_flush(MDB_txn *txn, int keep)
 #endif	/* _WIN32 */
 	}
 
+#if MDB_USE_IOURING
+	if (ring) {
+		int sync = synced && !(env->me_flags & MDB_NOSYNC), rc2;
+		/* The sync waits for the writes, without another system call */
+		rc = sync ? mdb_uring_queue(ring, IORING_OP_FSYNC, env->me_fd,
+			NULL, 0, 0, 0) : MDB_SUCCESS;
+		rc2 = mdb_uring_wait(ring);
+		if (rc || (rc = rc2)) {
+			DPRINTF(("io_uring flush: %s", mdb_strerror(rc)));
+			/* Entries are left only when the ring itself failed */
+			if (ring->mu_pending || ring->mu_inflight)
+				mdb_uring_fail(env);
+			return rc;
+		}
+		if (sync)
+			*synced = 1;
+		MDB_METRIC(env, uring_flushes, 1);
+	}
+#endif
+
+#if MDB_USE_WRITERS
+written:
+#endif
 	/* MIPS has cache coherency issues, this is a no-op everywhere else
 	 * Note: for any size >= on-chip cache size, entire on-chip cache is
 	 * flushed.
@@ -3167,19 +4745,204 @@ done:
 	i--;
 	txn->mt_dirty_room += i - j;
 	dl[0].mid = j;
+	txn->mt_dhash.dh_valid = 0;
+	MDB_PROBE2(page__flush__done, txn, i - j);
+	return MDB_SUCCESS;
+}
+
+/** Table of the byte-wise CRC-32C (Castagnoli, reflected 0x82F63B78) */
+static const uint32_t mdb_crc32c_table[256] = {
+	0x00000000, 0xf26b8303, 0xe13b70f7, 0x1350f3f4, 0xc79a971f, 0x35f1141c,
+	0x26a1e7e8, 0xd4ca64eb, 0x8ad958cf, 0x78b2dbcc, 0x6be22838, 0x9989ab3b,
+	0x4d43cfd0, 0xbf284cd3, 0xac78bf27, 0x5e133c24, 0x105ec76f, 0xe235446c,
+	0xf165b798, 0x030e349b, 0xd7c45070, 0x25afd373, 0x36ff2087, 0xc494a384,
+	0x9a879fa0, 0x68ec1ca3, 0x7bbcef57, 0x89d76c54, 0x5d1d08bf, 0xaf768bbc,
+	0xbc267848, 0x4e4dfb4b, 0x20bd8ede, 0xd2d60ddd, 0xc186fe29, 0x33ed7d2a,
+	0xe72719c1, 0x154c9ac2, 0x061c6936, 0xf477ea35, 0xaa64d611, 0x580f5512,
+	0x4b5fa6e6, 0xb93425e5, 0x6dfe410e, 0x9f95c20d, 0x8cc531f9, 0x7eaeb2fa,
+	0x30e349b1, 0xc288cab2, 0xd1d83946, 0x23b3ba45, 0xf779deae, 0x05125dad,
+	0x1642ae59, 0xe4292d5a, 0xba3a117e, 0x4851927d, 0x5b016189, 0xa96ae28a,
+	0x7da08661, 0x8fcb0562, 0x9c9bf696, 0x6ef07595, 0x417b1dbc, 0xb3109ebf,
+	0xa0406d4b, 0x522bee48, 0x86e18aa3, 0x748a09a0, 0x67dafa54, 0x95b17957,
+	0xcba24573, 0x39c9c670, 0x2a993584, 0xd8f2b687, 0x0c38d26c, 0xfe53516f,
+	0xed03a29b, 0x1f682198, 0x5125dad3, 0xa34e59d0, 0xb01eaa24, 0x42752927,
+	0x96bf4dcc, 0x64d4cecf, 0x77843d3b, 0x85efbe38, 0xdbfc821c, 0x2997011f,
+	0x3ac7f2eb, 0xc8ac71e8, 0x1c661503, 0xee0d9600, 0xfd5d65f4, 0x0f36e6f7,
+	0x61c69362, 0x93ad1061, 0x80fde395, 0x72966096, 0xa65c047d, 0x5437877e,
+	0x4767748a, 0xb50cf789, 0xeb1fcbad, 0x197448ae, 0x0a24bb5a, 0xf84f3859,
+	0x2c855cb2, 0xdeeedfb1, 0xcdbe2c45, 0x3fd5af46, 0x7198540d, 0x83f3d70e,
+	0x90a324fa, 0x62c8a7f9, 0xb602c312, 0x44694011, 0x5739b3e5, 0xa55230e6,
+	0xfb410cc2, 0x092a8fc1, 0x1a7a7c35, 0xe811ff36, 0x3cdb9bdd, 0xceb018de,
+	0xdde0eb2a, 0x2f8b6829, 0x82f63b78, 0x709db87b, 0x63cd4b8f, 0x91a6c88c,
+	0x456cac67, 0xb7072f64, 0xa457dc90, 0x563c5f93, 0x082f63b7, 0xfa44e0b4,
+	0xe9141340, 0x1b7f9043, 0xcfb5f4a8, 0x3dde77ab, 0x2e8e845f, 0xdce5075c,
+	0x92a8fc17, 0x60c37f14, 0x73938ce0, 0x81f80fe3, 0x55326b08, 0xa759e80b,
+	0xb4091bff, 0x466298fc, 0x1871a4d8, 0xea1a27db, 0xf94ad42f, 0x0b21572c,
+	0xdfeb33c7, 0x2d80b0c4, 0x3ed04330, 0xccbbc033, 0xa24bb5a6, 0x502036a5,
+	0x4370c551, 0xb11b4652, 0x65d122b9, 0x97baa1ba, 0x84ea524e, 0x7681d14d,
+	0x2892ed69, 0xdaf96e6a, 0xc9a99d9e, 0x3bc21e9d, 0xef087a76, 0x1d63f975,
+	0x0e330a81, 0xfc588982, 0xb21572c9, 0x407ef1ca, 0x532e023e, 0xa145813d,
+	0x758fe5d6, 0x87e466d5, 0x94b49521, 0x66df1622, 0x38cc2a06, 0xcaa7a905,
+	0xd9f75af1, 0x2b9cd9f2, 0xff56bd19, 0x0d3d3e1a, 0x1e6dcdee, 0xec064eed,
+	0xc38d26c4, 0x31e6a5c7, 0x22b65633, 0xd0ddd530, 0x0417b1db, 0xf67c32d8,
+	0xe52cc12c, 0x1747422f, 0x49547e0b, 0xbb3ffd08, 0xa86f0efc, 0x5a048dff,
+	0x8ecee914, 0x7ca56a17, 0x6ff599e3, 0x9d9e1ae0, 0xd3d3e1ab, 0x21b862a8,
+	0x32e8915c, 0xc083125f, 0x144976b4, 0xe622f5b7, 0xf5720643, 0x07198540,
+	0x590ab964, 0xab613a67, 0xb831c993, 0x4a5a4a90, 0x9e902e7b, 0x6cfbad78,
+	0x7fab5e8c, 0x8dc0dd8f, 0xe330a81a, 0x115b2b19, 0x020bd8ed, 0xf0605bee,
+	0x24aa3f05, 0xd6c1bc06, 0xc5914ff2, 0x37faccf1, 0x69e9f0d5, 0x9b8273d6,
+	0x88d28022, 0x7ab90321, 0xae7367ca, 0x5c18e4c9, 0x4f48173d, 0xbd23943e,
+	0xf36e6f75, 0x0105ec76, 0x12551f82, 0xe03e9c81, 0x34f4f86a, 0xc69f7b69,
+	0xd5cf889d, 0x27a40b9e, 0x79b737ba, 0x8bdcb4b9, 0x988c474d, 0x6ae7c44e,
+	0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351,
+};
+
+/** Extend a CRC-32C over a buffer, a byte at a time */
+static uint32_t
+mdb_crc32c_sw(uint32_t crc, const void *buf, size_t len)
+{
+	const unsigned char *p = buf;
+
+	crc = ~crc;
+	while (len--)
+		crc = mdb_crc32c_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+/** Extend a CRC-32C over a buffer with the SSE4.2 crc32 instruction */
+__attribute__((target("sse4.2")))
+static uint32_t
+mdb_crc32c_hw(uint32_t crc, const void *buf, size_t len)
+{
+	const unsigned char *p = buf;
+	unsigned long long c = ~crc & 0xffffffffU, v;
+
+	for (; len >= sizeof(v); p += sizeof(v), len -= sizeof(v)) {
+		memcpy(&v, p, sizeof(v));
+		c = __builtin_ia32_crc32di(c, v);
+	}
+	crc = c;
+	while (len--)
+		crc = __builtin_ia32_crc32qi(crc, *p++);
+	return ~crc;
+}
+#endif
+
+/** Extend a CRC-32C over a buffer.
+ * @param[in] crc the CRC of the preceding data, 0 to start
+ * @param[in] buf the data
+ * @param[in] len its length
+ * @return the CRC of the data so far.
+ */
+static uint32_t
+mdb_crc32c(uint32_t crc, const void *buf, size_t len)
+{
+#if defined(__GNUC__) && defined(__x86_64__)
+	if (__builtin_cpu_supports("sse4.2"))
+		return mdb_crc32c_hw(crc, buf, len);
+#endif
+	return mdb_crc32c_sw(crc, buf, len);
+}
+
+/** Compute the #ms_crc of a meta: over the fields a commit writes
+ * and its checksum record, less the CRC itself.
+ */
+static uint32_t
+mdb_meta_crc(const MDB_meta *m)
+{
+	const MDB_metasum *ms = METASUM(m);
+	uint32_t crc;
+
+	crc = mdb_crc32c(0, &m->mm_mapsize,
+		sizeof(MDB_meta) - offsetof(MDB_meta, mm_mapsize));
+	return mdb_crc32c(crc, &ms->ms_datacrc,
+		(const char *)&ms->ms_runs[ms->ms_nruns] - (const char *)&ms->ms_datacrc);
+}
+
+/** Collect the checksum record of a #MDB_SINGLESYNC commit.
+ *	Called just before the final #mdb_page_flush(), whose work of
+ *	clearing the dirty flags it does first, since the checksums
+ *	must match the pages as written.
+ * @param[in] txn the transaction that's being committed
+ * @param[out] ms the runs of pages to write and their CRC
+ * @return 0 on success, non-zero if the commit must sync twice.
+ */
+static int
+mdb_txn_sum(MDB_txn *txn, MDB_metasum *ms)
+{
+	MDB_env		*env = txn->mt_env;
+	MDB_ID2L	dl = txn->mt_u.dirty_list;
+	MDB_page	*dp;
+	MDB_sumrun	*run = NULL;
+	unsigned	psize = env->me_psize, i;
+	pgno_t		pgno, count;
+	uint32_t	crc = 0;
+
+	/* Pages spilled earlier were written without checksums */
+	if ((env->me_flags & (MDB_SINGLESYNC|MDB_WRITEMAP|MDB_NOSYNC)) != MDB_SINGLESYNC ||
+		txn->mt_spill_pgs)
+		return MDB_INCOMPATIBLE;
+
+	for (i = 1; i <= dl[0].mid; i++) {
+		dp = dl[i].mptr;
+		/* Skipped by mdb_page_flush() */
+		if (dp->mp_flags & (P_LOOSE|P_KEEP))
+			continue;
+		dp->mp_flags &= ~P_DIRTY;
+		pgno = dl[i].mid;
+		count = IS_OVERFLOW(dp) ? dp->mp_pages : 1;
+		if (run && run->sr_pgno + run->sr_count == pgno) {
+			run->sr_count += count;
+		} else {
+			if (run == &ms->ms_runs[MDB_SUM_RUNS-1])
+				return MDB_INCOMPATIBLE;
+			run = run ? run + 1 : ms->ms_runs;
+			run->sr_pgno = pgno;
+			run->sr_count = count;
+		}
+		crc = mdb_crc32c(crc, dp, count * psize);
+	}
+	ms->ms_nruns = run ? run - ms->ms_runs + 1 : 0;
+	ms->ms_datacrc = crc;
 	return MDB_SUCCESS;
 }
 
 int
 mdb_txn_commit(MDB_txn *txn)
+{
+	return mdb_txn_commit_ex(txn, NULL);
+}
+
+	/** Record the time since the last mark in a field of the
+	 *	commit latency, if it is being measured.
+	 */
+#define MDB_LATENCY_MARK(field)	do { \
+	if (latency) { \
+		uint64_t now = mdb_clock_usec(); \
+		latency->field = now - mark; \
+		mark = now; \
+	} } while (0)
+
+int
+mdb_txn_commit_ex(MDB_txn *txn, MDB_commit_latency *latency)
 {
 	int		rc;
 	unsigned int i;
 	MDB_env	*env;
+	MDB_metasum	sum, *sump;
+	int		synced;
+	uint64_t start = 0, mark = 0;
+
+	if (latency) {
+		memset(latency, 0, sizeof(*latency));
+		start = mark = mdb_clock_usec();
+	}
 
 	if (txn == NULL || txn->mt_env == NULL)
 		return EINVAL;
 
+	MDB_PROBE2(txn__commit, txn, txn->mt_txnid);
 	if (txn->mt_child) {
 		rc = mdb_txn_commit(txn->mt_child);
 		txn->mt_child = NULL;
@@ -3193,7 +4956,8 @@ mdb_txn_commit(MDB_txn *txn)
 		mdb_dbis_update(txn, 1);
 		txn->mt_numdbs = 2; /* so txn_abort() doesn't close any new handles */
 		mdb_txn_abort(txn);
-		return MDB_SUCCESS;
+		rc = MDB_SUCCESS;
+		goto leave;
 	}
 
 	if (F_ISSET(txn->mt_flags, MDB_TXN_ERROR)) {
@@ -3211,6 +4975,12 @@ mdb_txn_commit(MDB_txn *txn)
 		MDB_IDL pspill;
 		unsigned x, y, len, ps_len;
 
+		/* Make room in parent's dirty list for the merge below */
+		rc = mdb_dlist_grow(parent,
+			parent->mt_u.dirty_list[0].mid + txn->mt_u.dirty_list[0].mid);
+		if (rc)
+			goto fail;
+
 		/* Append our free list to parent's */
 		rc = mdb_midl_append_list(&parent->mt_free_pgs, txn->mt_free_pgs);
 		if (rc)
@@ -3260,23 +5030,43 @@ mdb_txn_commit(MDB_txn *txn)
 			pspill[0] = y;
 		}
 
-		/* Find len = length of merging our dirty list with parent's */
+		/* Remove anything in our spill list from parent's dirty list.
+		 * Our version of those pages is in the map now.
+		 */
+		if ((pspill = txn->mt_spill_pgs) && (ps_len = pspill[0])) {
+			len = dst[0].mid;
+			for (i = ps_len, x = y = 1; i; i--) {
+				pgno_t pn = pspill[i];
+				if (pn & 1)
+					continue;	/* deleted spillpg */
+				pn >>= 1;
+				while (x <= len && dst[x].mid < pn)
+					dst[y++] = dst[x++];
+				if (x <= len && dst[x].mid == pn)
+					mdb_dpage_free(env, dst[x++].mptr);
+			}
+			while (x <= len)
+				dst[y++] = dst[x++];
+			dst[0].mid = y - 1;
+		}
+
+		/* Find len = length of merging our dirty list with parent's.
+		 * Not derived from mt_dirty_room: spilling our copies of
+		 * parent's dirty pages gives us room they never took, so
+		 * the merged list can be longer than me_maxdirty allows.
+		 */
 		x = dst[0].mid;
 		dst[0].mid = 0;		/* simplify loops */
-		if (parent->mt_parent) {
-			len = x + src[0].mid;
-			y = mdb_mid2l_search(src, dst[x].mid + 1) - 1;
-			for (i = x; y && i; y--) {
-				pgno_t yp = src[y].mid;
-				while (yp < dst[i].mid)
-					i--;
-				if (yp == dst[i].mid) {
-					i--;
-					len--;
-				}
+		len = x + src[0].mid;
+		y = mdb_mid2l_search(src, dst[x].mid + 1) - 1;
+		for (i = x; y && i; y--) {
+			pgno_t yp = src[y].mid;
+			while (yp < dst[i].mid)
+				i--;
+			if (yp == dst[i].mid) {
+				i--;
+				len--;
 			}
-		} else { /* Simplify the above for single-ancestor case */
-			len = MDB_IDL_UM_MAX - txn->mt_dirty_room;
 		}
 		/* Merge our dirty list with parent's */
 		y = src[0].mid;
@@ -3285,11 +5075,13 @@ mdb_txn_commit(MDB_txn *txn)
 			while (yp < dst[x].mid)
 				dst[i--] = dst[x--];
 			if (yp == dst[x].mid)
-				free(dst[x--].mptr);
+				mdb_dpage_free(env, dst[x--].mptr);
 		}
 		mdb_tassert(txn, i == x);
 		dst[0].mid = len;
+		parent->mt_dhash.dh_valid = 0;
 		free(txn->mt_u.dirty_list);
+		free(txn->mt_dhash.dh_tab);
 		parent->mt_dirty_room = txn->mt_dirty_room;
 		if (txn->mt_spill_pgs) {
 			if (parent->mt_spill_pgs) {
@@ -3305,7 +5097,7 @@ mdb_txn_commit(MDB_txn *txn)
 		}
 
 		/* Append our loose page list to parent's */
-		for (lp = &parent->mt_loose_pgs; *lp; lp = &NEXT_LOOSE_PAGE(lp))
+		for (lp = &parent->mt_loose_pgs; *lp; lp = &NEXT_LOOSE_PAGE(*lp))
 			;
 		*lp = txn->mt_loose_pgs;
 		parent->mt_loose_count += txn->mt_loose_count;
@@ -3313,7 +5105,7 @@ mdb_txn_commit(MDB_txn *txn)
 		parent->mt_child = NULL;
 		mdb_midl_free(((MDB_ntxn *)txn)->mnt_pgstate.mf_pghead);
 		free(txn);
-		return rc;
+		goto leave;
 	}
 
 	if (txn != env->me_txn) {
@@ -3352,13 +5144,17 @@ mdb_txn_commit(MDB_txn *txn)
 			}
 		}
 	}
+	MDB_LATENCY_MARK(mcl_prepare);
 
 	rc = mdb_freelist_save(txn);
 	if (rc)
 		goto fail;
+	MDB_LATENCY_MARK(mcl_freelist);
 
 	mdb_midl_free(env->me_pghead);
 	env->me_pghead = NULL;
+	env->me_pgruns.mr_mop = NULL;
+	env->me_pgruns.mr_scanned = 0;
 	if (mdb_midl_shrink(&txn->mt_free_pgs))
 		env->me_free_pgs = txn->mt_free_pgs;
 
@@ -3366,32 +5162,67 @@ mdb_txn_commit(MDB_txn *txn)
 	mdb_audit(txn);
 #endif
 
-	if ((rc = mdb_page_flush(txn, 0)) ||
-		(rc = mdb_env_sync(env, 0)) ||
-		(rc = mdb_env_write_meta(txn)))
+	/* With checksums the meta goes out with the data and one sync
+	 * covers both, else the data is synced before the meta is written.
+	 */
+	sump = mdb_txn_sum(txn, &sum) ? NULL : &sum;
+	synced = 0;
+	if ((rc = mdb_page_flush(txn, 0, sump ? NULL : &synced)))
+		goto fail;
+	MDB_LATENCY_MARK(mcl_write);
+	if (!sump && !synced && (rc = mdb_env_sync(env, 0)))
+		goto fail;
+	MDB_LATENCY_MARK(mcl_sync);
+	if ((rc = mdb_env_write_meta(txn, sump)))
 		goto fail;
+	MDB_LATENCY_MARK(mcl_meta);
 
 	/* Free P_LOOSE pages left behind in dirty_list */
 	if (!(env->me_flags & MDB_WRITEMAP))
 		mdb_dlist_free(txn);
 
 done:
+	mdb_arena_reset(env);
 	env->me_pglast = 0;
 	env->me_txn = NULL;
 	mdb_dbis_update(txn, 1);
 
-	if (env->me_txns)
+	if (env->me_txns) {
 		UNLOCK_MUTEX_W(env);
+		MDB_PROBE1(wmutex__release, env);
+		mdb_env_notify(env);
+	}
 	if (txn != env->me_txn0)
 		free(txn);
-
-	return MDB_SUCCESS;
+	rc = MDB_SUCCESS;
+	goto leave;
 
 fail:
 	mdb_txn_abort(txn);
+leave:
+	if (latency)
+		latency->mcl_total = mdb_clock_usec() - start;
+	MDB_PROBE2(txn__commit__done, txn, rc);
 	return rc;
 }
 
+/** Check the checksum record of a meta, if it has one.
+ * @param[in] m the meta
+ * @return 0 if the meta has no checksums or they match its fields,
+ * else #MDB_CORRUPTED.
+ */
+static int
+mdb_meta_check(const MDB_meta *m)
+{
+	const MDB_metasum *ms = METASUM(m);
+
+	if (!ms->ms_txnid || ms->ms_txnid != m->mm_txnid)
+		return MDB_SUCCESS;
+	if (ms->ms_nruns > MDB_SUM_RUNS || ms->ms_crc != mdb_meta_crc(m))
+		return MDB_CORRUPTED;
+	return MDB_SUCCESS;
+}
+
 /** Read the environment parameters of a DB environment before
  * mapping it into memory.
  * @param[in] env the environment handle
@@ -3404,14 +5235,14 @@ mdb_env_read_header(MDB_env *env, MDB_meta *meta)
 	MDB_metabuf	pbuf;
 	MDB_page	*p;
 	MDB_meta	*m;
-	int			i, rc, off;
+	int			i, rc, off, found = 0;
 	enum { Size = sizeof(pbuf) };
 
 	/* We don't know the page size yet, so use a minimum value.
 	 * Read both meta pages so we can use the latest one.
 	 */
 
-	for (i=off=0; i<2; i++, off = meta->mm_psize) {
+	for (i=off=0; i<2; i++, off = m->mm_psize) {
 #ifdef _WIN32
 		DWORD len;
 		OVERLAPPED ov;
@@ -3444,16 +5275,23 @@ mdb_env_read_header(MDB_env *env, MDB_meta *meta)
 			return MDB_INVALID;
 		}
 
-		if (m->mm_version != MDB_DATA_VERSION) {
+		if (m->mm_version != MDB_DATA_VERSION &&
+			m->mm_version != MDB_RANGES_VERSION) {
 			DPRINTF(("database is version %u, expected version %u",
 				m->mm_version, MDB_DATA_VERSION));
 			return MDB_VERSION_MISMATCH;
 		}
 
-		if (off == 0 || m->mm_txnid > meta->mm_txnid)
+		/* A torn #MDB_SINGLESYNC meta, the other one is intact */
+		if (mdb_meta_check(m)) {
+			DPRINTF(("meta page %d is torn", i));
+			continue;
+		}
+
+		if (!found++ || m->mm_txnid > meta->mm_txnid)
 			*meta = *m;
 	}
-	return 0;
+	return found ? 0 : MDB_INVALID;
 }
 
 static void ESECT
@@ -3524,16 +5362,21 @@ mdb_env_init_meta(MDB_env *env, MDB_meta *meta)
 
 /** Update the environment info to commit a transaction.
  * @param[in] txn the transaction that's being committed
+ * @param[in] sum checksums of the pages just written, to write the meta
+ * along with them and sync once. NULL if they are already synced.
  * @return 0 on success, non-zero on failure.
  */
 static int
-mdb_env_write_meta(MDB_txn *txn)
+mdb_env_write_meta(MDB_txn *txn, MDB_metasum *sum)
 {
 	MDB_env *env;
-	MDB_meta	meta, metab, *mp;
+	MDB_metabuf	mbuf;
+	MDB_meta	*meta = &mbuf.mb_metabuf.mm_meta, metab, *mp;
+	MDB_metasum	*ms = &mbuf.mb_metabuf.mm_sum;
 	size_t mapsize;
 	off_t off;
 	int rc, len, toggle;
+	uint32_t version;
 	char *ptr;
 	HANDLE mfd;
 #ifdef _WIN32
@@ -3552,12 +5395,20 @@ mdb_env_write_meta(MDB_txn *txn)
 	/* Persist any increases of mapsize config */
 	if (mapsize < env->me_mapsize)
 		mapsize = env->me_mapsize;
+	/* Mark the file once its freeDB held range records, for good */
+	version = MDB_DATA_VERSION;
+	if ((txn->mt_flags & MDB_TXN_RANGES) ||
+		mp->mm_version == MDB_RANGES_VERSION ||
+		env->me_metas[toggle ^ 1]->mm_version == MDB_RANGES_VERSION)
+		version = MDB_RANGES_VERSION;
 
 	if (env->me_flags & MDB_WRITEMAP) {
+		mp->mm_version = version;
 		mp->mm_mapsize = mapsize;
 		mp->mm_dbs[0] = txn->mt_dbs[0];
 		mp->mm_dbs[1] = txn->mt_dbs[1];
 		mp->mm_last_pg = txn->mt_next_pgno - 1;
+		METASUM(mp)->ms_txnid = 0;
 		mp->mm_txnid = txn->mt_txnid;
 		if (!(env->me_flags & (MDB_NOMETASYNC|MDB_NOSYNC))) {
 			unsigned meta_size = env->me_psize;
@@ -3581,21 +5432,38 @@ mdb_env_write_meta(MDB_txn *txn)
 	metab.mm_txnid = env->me_metas[toggle]->mm_txnid;
 	metab.mm_last_pg = env->me_metas[toggle]->mm_last_pg;
 
-	meta.mm_mapsize = mapsize;
-	meta.mm_dbs[0] = txn->mt_dbs[0];
-	meta.mm_dbs[1] = txn->mt_dbs[1];
-	meta.mm_last_pg = txn->mt_next_pgno - 1;
-	meta.mm_txnid = txn->mt_txnid;
+	meta->mm_version = version;
+	meta->mm_address = mp->mm_address;
+	meta->mm_mapsize = mapsize;
+	meta->mm_dbs[0] = txn->mt_dbs[0];
+	meta->mm_dbs[1] = txn->mt_dbs[1];
+	meta->mm_last_pg = txn->mt_next_pgno - 1;
+	meta->mm_txnid = txn->mt_txnid;
 
-	off = offsetof(MDB_meta, mm_mapsize);
-	ptr = (char *)&meta + off;
-	len = sizeof(MDB_meta) - off;
+	/* Always write the head of the checksum record, so that a stale
+	 * one left by a torn commit of the same txnid cannot match.
+	 */
+	len = offsetof(MDB_metasum, ms_runs);
+	if (sum) {
+		ms->ms_datacrc = sum->ms_datacrc;
+		ms->ms_txnid = txn->mt_txnid;
+		ms->ms_nruns = sum->ms_nruns;
+		memcpy(ms->ms_runs, sum->ms_runs, sum->ms_nruns * sizeof(MDB_sumrun));
+		ms->ms_crc = mdb_meta_crc(meta);
+		len += sum->ms_nruns * sizeof(MDB_sumrun);
+	} else {
+		memset(ms, 0, len);
+	}
+
+	off = offsetof(MDB_meta, mm_version);
+	ptr = (char *)meta + off;
+	len += sizeof(MDB_meta) - off;
 	if (toggle)
 		off += env->me_psize;
 	off += PAGEHDRSZ;
 
-	/* Write to the SYNC fd */
-	mfd = env->me_flags & (MDB_NOSYNC|MDB_NOMETASYNC) ?
+	/* Write to the SYNC fd, unless we sync the data and meta together */
+	mfd = sum || (env->me_flags & (MDB_NOSYNC|MDB_NOMETASYNC)) ?
 		env->me_fd : env->me_mfd;
 #ifdef _WIN32
 	{
@@ -3614,8 +5482,8 @@ mdb_env_write_meta(MDB_txn *txn)
 		 * Write some old data back, to prevent it from being used.
 		 * Use the non-SYNC fd; we know it will fail anyway.
 		 */
-		meta.mm_last_pg = metab.mm_last_pg;
-		meta.mm_txnid = metab.mm_txnid;
+		meta->mm_last_pg = metab.mm_last_pg;
+		meta->mm_txnid = metab.mm_txnid;
 #ifdef _WIN32
 		memset(&ov, 0, sizeof(ov));
 		ov.Offset = off;
@@ -3628,6 +5496,11 @@ fail:
 		env->me_flags |= MDB_FATAL_ERROR;
 		return rc;
 	}
+	if (sum) {
+		if ((rc = mdb_env_sync(env, 0)))
+			goto fail;
+		MDB_METRIC(env, single_syncs, 1);
+	}
 	/* MIPS has cache coherency issues, this is a no-op everywhere else */
 	CACHEFLUSH(env->me_map + off, len, DCACHE);
 done:
@@ -3643,14 +5516,109 @@ done:
 	return MDB_SUCCESS;
 }
 
-/** Check both meta pages to see which one is newer.
- * @param[in] env the environment handle
- * @return meta toggle (0 or 1).
- */
-static int
-mdb_env_pick_meta(const MDB_env *env)
-{
-	return (env->me_metas[0]->mm_txnid < env->me_metas[1]->mm_txnid);
+/** Check both meta pages to see which one is newer.
+ * @param[in] env the environment handle
+ * @return meta toggle (0 or 1).
+ */
+static int
+mdb_env_pick_meta(const MDB_env *env)
+{
+	int toggle = (env->me_metas[0]->mm_txnid < env->me_metas[1]->mm_txnid);
+	const MDB_meta *m = env->me_metas[toggle];
+
+	/* Pass over a meta that #mdb_env_check_meta() found torn */
+	if (env->me_badtxnid && m->mm_txnid == env->me_badtxnid &&
+		METASUM(m)->ms_txnid == m->mm_txnid &&
+		METASUM(m)->ms_crc == env->me_badcrc)
+		toggle ^= 1;
+	return toggle;
+}
+
+/** Verify the newest meta against the checksums of a #MDB_SINGLESYNC
+ *	commit. Called by the first process to open the environment, or
+ *	without locking, since only then no commit can be under way. Later
+ *	read-write openers call it again holding the writer mutex, since a
+ *	read-only first opener does not repair the meta. A meta whose fields
+ *	or pages do not match is overwritten by the previous one, or only
+ *	passed over when the environment is read-only.
+ * @param[in] env the environment handle
+ * @return 0 on success, non-zero on failure.
+ */
+static int ESECT
+mdb_env_check_meta(MDB_env *env)
+{
+	int toggle = mdb_env_pick_meta(env), rc, len;
+	MDB_meta *m = env->me_metas[toggle];
+	MDB_metasum *ms = METASUM(m);
+	MDB_metabuf mbuf;
+	MDB_meta *meta = &mbuf.mb_metabuf.mm_meta;
+	unsigned psize = env->me_psize;
+	size_t fsize, maxpg;
+	uint32_t crc = 0;
+	pgno_t i;
+	off_t off;
+	char *ptr;
+
+	if (!ms->ms_txnid || ms->ms_txnid != m->mm_txnid)
+		return MDB_SUCCESS;
+	if (mdb_meta_check(m))
+		goto torn;
+
+	/* Pages past the end of the file were lost, and are not mapped */
+	{
+#ifdef _WIN32
+		DWORD hi, lo = GetFileSize(env->me_fd, &hi);
+		fsize = lo | ((size_t)hi << 16 << 16);
+#else
+		struct stat st;
+		if (fstat(env->me_fd, &st))
+			return ErrCode();
+		fsize = st.st_size;
+#endif
+	}
+	maxpg = fsize / psize;
+	if (maxpg > env->me_maxpg)
+		maxpg = env->me_maxpg;
+	for (i = 0; i < ms->ms_nruns; i++) {
+		MDB_sumrun *run = &ms->ms_runs[i];
+		if (run->sr_pgno < 2 || run->sr_count > maxpg ||
+			run->sr_pgno > maxpg - run->sr_count)
+			goto torn;
+		crc = mdb_crc32c(crc, env->me_map + run->sr_pgno * psize,
+			run->sr_count * psize);
+	}
+	if (crc == ms->ms_datacrc)
+		return MDB_SUCCESS;
+
+torn:
+	DPRINTF(("meta page %d of txn %"Z"u is torn", toggle, m->mm_txnid));
+	if (env->me_flags & MDB_RDONLY) {
+		env->me_badtxnid = m->mm_txnid;
+		env->me_badcrc = ms->ms_crc;
+		return MDB_SUCCESS;
+	}
+
+	/* Copy the previous meta over it, with no checksums */
+	*meta = *env->me_metas[toggle ^ 1];
+	memset(&mbuf.mb_metabuf.mm_sum, 0, offsetof(MDB_metasum, ms_runs));
+	off = PAGEHDRSZ + offsetof(MDB_meta, mm_mapsize);
+	ptr = (char *)&mbuf + off;
+	len = PAGEHDRSZ + sizeof(MDB_meta) + offsetof(MDB_metasum, ms_runs) - off;
+	off += toggle * psize;
+#ifdef _WIN32
+	{
+		OVERLAPPED ov;
+		memset(&ov, 0, sizeof(ov));
+		ov.Offset = off;
+		if (!WriteFile(env->me_fd, ptr, len, (DWORD *)&rc, &ov))
+			rc = -1;
+	}
+#else
+	rc = pwrite(env->me_fd, ptr, len, off);
+#endif
+	if (rc != len)
+		return rc < 0 ? ErrCode() : EIO;
+	return mdb_env_sync(env, 1);
 }
 
 int ESECT
@@ -3663,6 +5631,8 @@ mdb_env_create(MDB_env **env)
 		return ENOMEM;
 
 	e->me_maxreaders = DEFAULT_READERS;
+	e->me_maxdirty = MDB_IDL_UM_MAX;
+	e->me_writers = 1;
 	e->me_maxdbs = e->me_numdbs = 2;
 	e->me_fd = INVALID_HANDLE_VALUE;
 	e->me_lfd = INVALID_HANDLE_VALUE;
@@ -3678,6 +5648,32 @@ mdb_env_create(MDB_env **env)
 	return MDB_SUCCESS;
 }
 
+	/** Internal access pattern hint, prefetch the pages */
+#define MDB_ADVISE_WILLNEED	3
+
+	/** Give the OS an access pattern hint for part of the memory map.
+	 * @param[in] env An environment handle
+	 * @param[in] off Offset of the first byte in the map
+	 * @param[in] len Number of bytes
+	 * @param[in] advice One of the @ref mdb_advise values or #MDB_ADVISE_WILLNEED
+	 */
+static void
+mdb_madvise(MDB_env *env, size_t off, size_t len, int advice)
+{
+#ifndef _WIN32
+	/* madvise() wants an address aligned to an OS page */
+	size_t start = off - off % env->me_os_psize;
+#ifdef MADV_NORMAL
+	static const int advs[] = { MADV_NORMAL, MADV_RANDOM, MADV_SEQUENTIAL, MADV_WILLNEED };
+	madvise(env->me_map + start, len + off - start, advs[advice]);
+#elif defined(POSIX_MADV_NORMAL)
+	static const int advs[] = { POSIX_MADV_NORMAL, POSIX_MADV_RANDOM,
+		POSIX_MADV_SEQUENTIAL, POSIX_MADV_WILLNEED };
+	posix_madvise(env->me_map + start, len + off - start, advs[advice]);
+#endif
+#endif
+}
+
 static int ESECT
 mdb_env_map(MDB_env *env, void *addr)
 {
@@ -3722,13 +5718,18 @@ mdb_env_map(MDB_env *env, void *addr)
 	if (rc)
 		return rc;
 #else
-	int prot = PROT_READ;
+	int prot = PROT_READ, mflags = MAP_SHARED;
 	if (flags & MDB_WRITEMAP) {
 		prot |= PROT_WRITE;
 		if (ftruncate(env->me_fd, env->me_mapsize) < 0)
 			return ErrCode();
 	}
-	env->me_map = mmap(addr, env->me_mapsize, prot, MAP_SHARED,
+#ifdef MAP_POPULATE
+	/* Read the whole file in now rather than fault it in page by page */
+	if (flags & MDB_MAPPOPULATE)
+		mflags |= MAP_POPULATE;
+#endif
+	env->me_map = mmap(addr, env->me_mapsize, prot, mflags,
 		env->me_fd, 0);
 	if (env->me_map == MAP_FAILED) {
 		env->me_map = NULL;
@@ -3745,6 +5746,8 @@ mdb_env_map(MDB_env *env, void *addr)
 #endif /* POSIX_MADV_RANDOM */
 #endif /* MADV_RANDOM */
 	}
+	if (env->me_advice)
+		mdb_madvise(env, 0, env->me_mapsize, env->me_advice);
 #endif /* _WIN32 */
 
 	/* Can happen because the address argument to mmap() is just a
@@ -3823,6 +5826,42 @@ mdb_env_get_maxreaders(MDB_env *env, unsigned int *readers)
 	return MDB_SUCCESS;
 }
 
+int ESECT
+mdb_env_set_maxdirty(MDB_env *env, unsigned int pages)
+{
+	if (env->me_map || pages < MDB_MAXDIRTY_MIN)
+		return EINVAL;
+	env->me_maxdirty = pages;
+	return MDB_SUCCESS;
+}
+
+int ESECT
+mdb_env_get_maxdirty(MDB_env *env, unsigned int *pages)
+{
+	if (!env || !pages)
+		return EINVAL;
+	*pages = env->me_maxdirty;
+	return MDB_SUCCESS;
+}
+
+int ESECT
+mdb_env_set_writers(MDB_env *env, unsigned int writers)
+{
+	if (env->me_map || writers < 1 || writers > MDB_WRITERS_MAX)
+		return EINVAL;
+	env->me_writers = writers;
+	return MDB_SUCCESS;
+}
+
+int ESECT
+mdb_env_get_writers(MDB_env *env, unsigned int *writers)
+{
+	if (!env || !writers)
+		return EINVAL;
+	*writers = env->me_writers;
+	return MDB_SUCCESS;
+}
+
 /** Further setup required for opening an LMDB environment
  */
 static int ESECT
@@ -4388,9 +6427,10 @@ fail:
 	 *	at runtime. Changing other flags requires closing the
 	 *	environment and re-opening it with the new flags.
 	 */
-#define	CHANGEABLE	(MDB_NOSYNC|MDB_NOMETASYNC|MDB_MAPASYNC|MDB_NOMEMINIT)
+#define	CHANGEABLE	(MDB_NOSYNC|MDB_NOMETASYNC|MDB_MAPASYNC|MDB_NOMEMINIT| \
+	MDB_FREERANGES|MDB_SINGLESYNC|MDB_IOURING)
 #define	CHANGELESS	(MDB_FIXEDMAP|MDB_NOSUBDIR|MDB_RDONLY|MDB_WRITEMAP| \
-	MDB_NOTLS|MDB_NOLOCK|MDB_NORDAHEAD)
+	MDB_NOTLS|MDB_NOLOCK|MDB_NORDAHEAD|MDB_MAPPOPULATE)
 
 #if VALID_FLAGS & PERSISTENT_FLAGS & (CHANGEABLE|CHANGELESS)
 # error "Persistent DB flags & env flags overlap, but both go in mm_flags"
@@ -4430,8 +6470,10 @@ mdb_env_open(MDB_env *env, const char *path, unsigned int flags, mdb_mode_t mode
 		/* silently ignore WRITEMAP when we're only getting read access */
 		flags &= ~MDB_WRITEMAP;
 	} else {
+		env->me_dirty_cap = MDB_DIRTY_INIT < env->me_maxdirty ?
+			MDB_DIRTY_INIT : env->me_maxdirty;
 		if (!((env->me_free_pgs = mdb_midl_alloc(MDB_IDL_UM_MAX)) &&
-			  (env->me_dirty_list = calloc(MDB_IDL_UM_SIZE, sizeof(MDB_ID2)))))
+			  (env->me_dirty_list = calloc(env->me_dirty_cap + 1, sizeof(MDB_ID2)))))
 			rc = ENOMEM;
 	}
 	env->me_flags = flags |= MDB_ENV_ACTIVE;
@@ -4485,6 +6527,16 @@ mdb_env_open(MDB_env *env, const char *path, unsigned int flags, mdb_mode_t mode
 	}
 
 	if ((rc = mdb_env_open2(env)) == MDB_SUCCESS) {
+		if (excl > 0 || !env->me_txns) {
+			rc = mdb_env_check_meta(env);
+		} else if (!(flags & MDB_RDONLY)) {
+			/* A read-only first opener only passed over a torn meta */
+			LOCK_MUTEX_W(env);
+			rc = mdb_env_check_meta(env);
+			UNLOCK_MUTEX_W(env);
+		}
+		if (rc)
+			goto leave;
 		if (flags & (MDB_RDONLY|MDB_WRITEMAP)) {
 			env->me_mfd = env->me_fd;
 		} else {
@@ -4559,6 +6611,10 @@ mdb_env_close0(MDB_env *env, int excl)
 	free(env->me_dbxs);
 	free(env->me_path);
 	free(env->me_dirty_list);
+	if (env->me_txn0)
+		free(env->me_txn0->mt_dhash.dh_tab);
+	free(env->me_pgruns.mr_runs);
+	free(env->me_pgruns.mr_tree);
 	mdb_midl_free(env->me_free_pgs);
 
 	if (env->me_flags & MDB_ENV_TXKEY) {
@@ -4634,17 +6690,18 @@ mdb_env_close0(MDB_env *env, int excl)
 void ESECT
 mdb_env_close(MDB_env *env)
 {
-	MDB_page *dp;
-
 	if (env == NULL)
 		return;
 
 	VGMEMP_DESTROY(env);
-	while ((dp = env->me_dpages) != NULL) {
-		VGMEMP_DEFINED(&dp->mp_next, sizeof(dp->mp_next));
-		env->me_dpages = dp->mp_next;
-		free(dp);
-	}
+	mdb_arena_unmap(&env->me_arena, 0);
+	free(env->me_arena.ma_chunks);
+#if MDB_USE_IOURING
+	mdb_uring_close(env);
+#endif
+#if MDB_USE_WRITERS
+	mdb_wpool_close(env);
+#endif
 
 	mdb_env_close0(env, 0);
 	free(env);
@@ -4914,7 +6971,6 @@ mdb_page_get(MDB_txn *txn, pgno_t pgno, MDB_page **ret, int *lvl)
 		MDB_txn *tx2 = txn;
 		level = 1;
 		do {
-			MDB_ID2L dl = tx2->mt_u.dirty_list;
 			unsigned x;
 			/* Spilled pages were dirtied in this txn and flushed
 			 * because the dirty list got full. Bring this page
@@ -4929,13 +6985,8 @@ mdb_page_get(MDB_txn *txn, pgno_t pgno, MDB_page **ret, int *lvl)
 					goto done;
 				}
 			}
-			if (dl[0].mid) {
-				unsigned x = mdb_mid2l_search(dl, pgno);
-				if (x <= dl[0].mid && dl[x].mid == pgno) {
-					p = dl[x].mptr;
-					goto done;
-				}
-			}
+			if ((p = mdb_dlist_find(tx2, pgno)) != NULL)
+				goto done;
 			level++;
 		} while ((tx2 = tx2->mt_parent) != NULL);
 	}
@@ -5187,6 +7238,7 @@ mdb_ovpage_free(MDB_cursor *mc, MDB_page *mp)
 				return MDB_CORRUPTED;
 			}
 		}
+		mdb_dhash_del(txn, pg);
 		if (!(env->me_flags & MDB_WRITEMAP))
 			mdb_dpage_free(env, mp);
 release:
@@ -5317,6 +7369,98 @@ mdb_cursor_sibling(MDB_cursor *mc, int move_right)
 	return MDB_SUCCESS;
 }
 
+/** Prefetch the next leaf into the CPU cache when a scan nears the end
+ * of the current one. Only siblings under the same parent are known.
+ * @param[in] mc A cursor on a leaf page.
+ */
+static void
+mdb_cursor_prefetch(MDB_cursor *mc)
+{
+	MDB_env *env = mc->mc_txn->mt_env;
+	MDB_page *parent;
+	unsigned int i;
+	char *p;
+
+	if (mc->mc_snum < 2)
+		return;
+	parent = mc->mc_pg[mc->mc_top - 1];
+	i = mc->mc_ki[mc->mc_top - 1] + 1;
+	if (i >= NUMKEYS(parent))
+		return;
+	/* Dirty pages are not in the map, prefetching them is just useless.
+	 * The header and the node pointers are at the start of the page,
+	 * the first nodes are usually at its end.
+	 */
+	p = env->me_map + NODEPGNO(NODEPTR(parent, i)) * env->me_psize;
+	MDB_PREFETCH(p);
+	MDB_PREFETCH(p + env->me_psize - 1);
+}
+
+/** Prefetch the pages a forward scan will need after the current leaf:
+ * the overflow pages of the values left in it, and the next
+ * #MDB_READAHEAD_LEAVES leaves, in batches of half of that.
+ * Done once per leaf.
+ * @param[in] mc A cursor with #C_SEQUENTIAL set.
+ */
+static void
+mdb_cursor_readahead(MDB_cursor *mc)
+{
+	MDB_env *env = mc->mc_txn->mt_env;
+	MDB_page *mp = mc->mc_pg[mc->mc_top], *parent;
+	MDB_node *node;
+	pgno_t pgno, run, len;
+	unsigned int i, end;
+
+	if (!IS_LEAF(mp) || mp->mp_pgno == mc->mc_rapg)
+		return;
+	mc->mc_rapg = mp->mp_pgno;
+
+	if (!IS_LEAF2(mp)) {
+		for (i = mc->mc_ki[mc->mc_top]; i < NUMKEYS(mp); i++) {
+			node = NODEPTR(mp, i);
+			if (!F_ISSET(node->mn_flags, F_BIGDATA))
+				continue;
+			memcpy(&pgno, NODEDATA(node), sizeof(pgno));
+			mdb_madvise(env, pgno * env->me_psize,
+				OVPAGES(NODEDSZ(node), env->me_psize) * env->me_psize,
+				MDB_ADVISE_WILLNEED);
+		}
+	}
+
+	if (mc->mc_snum < 2)
+		return;
+	parent = mc->mc_pg[mc->mc_top - 1];
+	i = mc->mc_ki[mc->mc_top - 1] + 1;
+	if (parent->mp_pgno == mc->mc_rapp) {
+		if (i + MDB_READAHEAD_LEAVES / 2 < mc->mc_raend)
+			return;
+		if (i < mc->mc_raend)
+			i = mc->mc_raend;
+	}
+	end = i + MDB_READAHEAD_LEAVES;
+	if (end > NUMKEYS(parent))
+		end = NUMKEYS(parent);
+	mc->mc_rapp = parent->mp_pgno;
+	mc->mc_raend = end;
+
+	/* Leaves written in order are often adjacent, advise runs of them */
+	for (run = len = 0; i < end; i++) {
+		pgno = NODEPGNO(NODEPTR(parent, i));
+		if (len && pgno == run + len) {
+			len++;
+			continue;
+		}
+		if (len)
+			mdb_madvise(env, run * env->me_psize, len * env->me_psize,
+				MDB_ADVISE_WILLNEED);
+		run = pgno;
+		len = 1;
+	}
+	if (len)
+		mdb_madvise(env, run * env->me_psize, len * env->me_psize,
+			MDB_ADVISE_WILLNEED);
+}
+
 /** Move the cursor to the next data item. */
 static int
 mdb_cursor_next(MDB_cursor *mc, MDB_val *key, MDB_val *data, MDB_cursor_op op)
@@ -5367,6 +7511,11 @@ mdb_cursor_next(MDB_cursor *mc, MDB_val *key, MDB_val *data, MDB_cursor_op op)
 	} else
 		mc->mc_ki[mc->mc_top]++;
 
+	/* Start loading the next leaf a few keys before it is needed */
+	if ((unsigned int)mc->mc_ki[mc->mc_top] + MDB_PREFETCH_KEYS == NUMKEYS(mp) ||
+		(mc->mc_ki[mc->mc_top] == 0 && NUMKEYS(mp) < MDB_PREFETCH_KEYS))
+		mdb_cursor_prefetch(mc);
+
 skip:
 	DPRINTF(("==> cursor points to page %"Z"u with %u keys, key index %u",
 	    mdb_dbg_pgno(mp), NUMKEYS(mp), mc->mc_ki[mc->mc_top]));
@@ -5924,6 +8073,8 @@ fetchm:
 
 	if (mc->mc_flags & C_DEL)
 		mc->mc_flags ^= C_DEL;
+	if ((mc->mc_flags & C_SEQUENTIAL) && rc == MDB_SUCCESS)
+		mdb_cursor_readahead(mc);
 
 	return rc;
 }
@@ -6301,14 +8452,19 @@ current:
 				if (level > 1) {
 					/* It is writable only in a parent txn */
 					size_t sz = (size_t) env->me_psize * ovpages, off;
-					MDB_page *np = mdb_page_malloc(mc->mc_txn, ovpages);
+					MDB_page *np;
 					MDB_ID2 id2;
+					if ((rc2 = mdb_dlist_grow(mc->mc_txn,
+						mc->mc_txn->mt_u.dirty_list[0].mid + 1)))
+						return rc2;
+					np = mdb_page_malloc(mc->mc_txn, ovpages);
 					if (!np)
 						return ENOMEM;
 					id2.mid = pg;
 					id2.mptr = np;
 					rc2 = mdb_mid2l_insert(mc->mc_txn->mt_u.dirty_list, &id2);
 					mdb_cassert(mc, rc2 == 0);
+					mdb_dhash_add(mc->mc_txn, &id2);
 					if (!(flags & MDB_RESERVE)) {
 						/* Copy end of page, adjusting alignment so
 						 * compiler may copy words instead of bytes.
@@ -6986,6 +9142,8 @@ mdb_cursor_init(MDB_cursor *mc, MDB_txn *txn, MDB_dbi dbi, MDB_xcursor *mx)
 	mc->mc_top = 0;
 	mc->mc_pg[0] = 0;
 	mc->mc_flags = 0;
+	mc->mc_rapg = P_INVALID;
+	mc->mc_rapp = P_INVALID;
 	if (txn->mt_dbs[dbi].md_flags & MDB_DUPSORT) {
 		mdb_tassert(txn, mx != NULL);
 		mc->mc_xcursor = mx;
@@ -7110,6 +9268,22 @@ mdb_cursor_dbi(MDB_cursor *mc)
 	return mc->mc_dbi;
 }
 
+int
+mdb_cursor_advise(MDB_cursor *mc, int advice)
+{
+	if (mc == NULL || advice < MDB_ADVISE_NORMAL || advice > MDB_ADVISE_SEQUENTIAL)
+		return EINVAL;
+
+	if (advice == MDB_ADVISE_SEQUENTIAL) {
+		mc->mc_flags |= C_SEQUENTIAL;
+		mc->mc_rapg = P_INVALID;
+		mc->mc_rapp = P_INVALID;
+	} else {
+		mc->mc_flags &= ~C_SEQUENTIAL;
+	}
+	return MDB_SUCCESS;
+}
+
 /** Replace the key for a branch node with a new key.
  * @param[in] mc Cursor pointing to the node to operate on.
  * @param[in] key The new key to use.
@@ -7394,6 +9568,7 @@ mdb_page_merge(MDB_cursor *csrc, MDB_cursor *cdst)
 	/* Mark dst as dirty. */
 	if ((rc = mdb_page_touch(cdst)))
 		return rc;
+	MDB_METRIC(cdst->mc_txn->mt_env, merges, 1);
 
 	/* Move all nodes from src to dst.
 	 */
@@ -7860,6 +10035,8 @@ mdb_page_split(MDB_cursor *mc, MDB_val *newkey, MDB_val *newdata, pgno_t newpgno
 	/* Create a right sibling. */
 	if ((rc = mdb_page_new(mc, mp->mp_flags, 1, &rp)))
 		return rc;
+	MDB_METRIC(env, splits, 1);
+	MDB_PROBE3(page__split, mp->mp_pgno, rp->mp_pgno, nkeys);
 	DPRINTF(("new right sibling: page %"Z"u", rp->mp_pgno));
 
 	if (mc->mc_snum < 2) {
@@ -8575,7 +10752,7 @@ mdb_env_copyfd1(MDB_env *env, HANDLE fd)
 		MDB_val key, data;
 		mdb_cursor_init(&mc, txn, FREE_DBI, NULL);
 		while ((rc = mdb_cursor_get(&mc, &key, &data, MDB_NEXT)) == 0)
-			freecount += *(MDB_ID *)data.mv_data;
+			freecount += mdb_midl_count(data.mv_data);
 		freecount += txn->mt_dbs[0].md_branch_pages +
 			txn->mt_dbs[0].md_leaf_pages +
 			txn->mt_dbs[0].md_overflow_pages;
@@ -8913,6 +11090,8 @@ mdb_env_info(MDB_env *env, MDB_envinfo *arg)
 	arg->me_mapaddr = env->me_metas[toggle]->mm_address;
 	arg->me_mapsize = env->me_mapsize;
 	arg->me_maxreaders = env->me_maxreaders;
+	arg->me_maxdirty = env->me_maxdirty;
+	arg->me_writers = env->me_writers;
 
 	/* me_numreaders may be zero if this process never used any readers. Use
 	 * the shared numreader count if it exists.
@@ -8924,6 +11103,78 @@ mdb_env_info(MDB_env *env, MDB_envinfo *arg)
 	return MDB_SUCCESS;
 }
 
+int ESECT
+mdb_env_metrics(MDB_env *env, MDB_metrics *arg, unsigned int flags)
+{
+	if (env == NULL || arg == NULL)
+		return EINVAL;
+
+	*arg = env->me_metrics;
+	if (flags & MDB_METRICS_RESET)
+		memset(&env->me_metrics, 0, sizeof(env->me_metrics));
+	return MDB_SUCCESS;
+}
+
+int ESECT
+mdb_env_advise(MDB_env *env, int advice)
+{
+	if (env == NULL || advice < MDB_ADVISE_NORMAL || advice > MDB_ADVISE_SEQUENTIAL)
+		return EINVAL;
+
+	env->me_advice = advice;
+	if (env->me_map)
+		mdb_madvise(env, 0, env->me_mapsize, advice);
+	return MDB_SUCCESS;
+}
+
+#ifndef MDB_MINCORE_CHUNK
+/** OS pages checked by each mincore() call of #mdb_env_mincore() */
+#define MDB_MINCORE_CHUNK	4096
+#endif
+
+int ESECT
+mdb_env_mincore(MDB_env *env, size_t first, size_t count, unsigned char *vec)
+{
+#ifdef _WIN32
+	return ENOSYS;
+#else
+	size_t psize, os_psize, off, end, start, i, j, k, n;
+	unsigned char osvec[MDB_MINCORE_CHUNK];
+
+	if (env == NULL || vec == NULL || env->me_map == NULL)
+		return EINVAL;
+	psize = env->me_psize;
+	os_psize = env->me_os_psize;
+	if (first > env->me_mapsize / psize || count > env->me_mapsize / psize - first)
+		return EINVAL;
+
+	/* Pages per call, so that their OS pages fit in osvec even when
+	 * the first one does not start an OS page
+	 */
+	n = (MDB_MINCORE_CHUNK - 1) * os_psize / psize;
+	off = first * psize;
+	for (; count; vec += n, count -= n) {
+		if (n > count)
+			n = count;
+		end = off + n * psize;
+		/* mincore() wants an address aligned to an OS page */
+		start = off - off % os_psize;
+		if (mincore(env->me_map + start, end - start, (void *)osvec))
+			return ErrCode();
+		for (i = 0; i < n; i++, off += psize) {
+			vec[i] = 1;
+			for (j = (off - start) / os_psize, k = (off + psize - 1 - start) / os_psize; j <= k; j++) {
+				if (!(osvec[j] & 1)) {
+					vec[i] = 0;
+					break;
+				}
+			}
+		}
+	}
+	return MDB_SUCCESS;
+#endif
+}
+
 /** Set the default comparison functions for a database.
  * Called immediately after a database is opened to set the defaults.
  * The user can then override them with #mdb_set_compare() or
@@ -9072,6 +11323,307 @@ int mdb_stat(MDB_txn *txn, MDB_dbi dbi, MDB_stat *arg)
 	return mdb_stat0(txn->mt_env, &txn->mt_dbs[dbi], arg);
 }
 
+	/** State of a #mdb_walk() */
+typedef struct mdb_walker {
+	MDB_txn		*mw_txn;
+	MDB_walk_page_func	*mw_page;
+	MDB_walk_node_func	*mw_node;
+	void		*mw_ctx;
+	/** Nodes with #F_SUBDATA are dupsort sub-DBs, not named DBs */
+	int		mw_dupsort;
+} mdb_walker;
+
+	/** Visit a page and everything below it.
+	 * @param[in] w The walk state
+	 * @param[in] pgno The page to visit
+	 * @param[in] depth The level of the page
+	 * @param[in] sub #MDB_WALK_SUBDB when walking a dupsort sub-DB, else 0
+	 * @param[in,out] pages If not NULL, incremented for each page visited
+	 * @return 0 on success, non-zero on failure.
+	 */
+static int
+mdb_walk_page(mdb_walker *w, pgno_t pgno, unsigned int depth,
+	unsigned int sub, size_t *pages)
+{
+	MDB_env *env = w->mw_txn->mt_env;
+	MDB_page *mp, *omp;
+	MDB_page_info pi;
+	MDB_node_info ni;
+	MDB_node *node;
+	MDB_db db;
+	pgno_t pg;
+	unsigned int i, nkeys;
+	int rc;
+
+	if (depth >= CURSOR_STACK)
+		return MDB_CORRUPTED;
+	if ((rc = mdb_page_get(w->mw_txn, pgno, &mp, NULL)))
+		return rc;
+
+	nkeys = NUMKEYS(mp);
+	pi.mpi_pgno = pgno;
+	pi.mpi_flags = sub | (IS_BRANCH(mp) ? MDB_WALK_BRANCH :
+		IS_LEAF2(mp) ? MDB_WALK_LEAF|MDB_WALK_LEAF2 : MDB_WALK_LEAF);
+	pi.mpi_depth = depth;
+	pi.mpi_pages = 1;
+	pi.mpi_nkeys = nkeys;
+	pi.mpi_used = env->me_psize - SIZELEFT(mp);
+	if (pages)
+		(*pages)++;
+	if (w->mw_page && (rc = w->mw_page(&pi, w->mw_ctx)))
+		return rc;
+
+	if (IS_BRANCH(mp)) {
+		for (i = 0; i < nkeys; i++) {
+			rc = mdb_walk_page(w, NODEPGNO(NODEPTR(mp, i)), depth + 1, sub, pages);
+			if (rc)
+				return rc;
+		}
+		return MDB_SUCCESS;
+	}
+
+	/* The items of a sub-DB are the duplicates of a single key */
+	if (sub || IS_LEAF2(mp))
+		return MDB_SUCCESS;
+
+	for (i = 0; i < nkeys; i++) {
+		node = NODEPTR(mp, i);
+		ni.mni_pgno = pgno;
+		ni.mni_flags = 0;
+		ni.mni_ksize = NODEKSZ(node);
+		ni.mni_dsize = NODEDSZ(node);
+		ni.mni_dups = 1;
+		ni.mni_pages = 0;
+		if (node->mn_flags & F_BIGDATA) {
+			memcpy(&pg, NODEDATA(node), sizeof(pg));
+			if ((rc = mdb_page_get(w->mw_txn, pg, &omp, NULL)))
+				return rc;
+			ni.mni_flags = MDB_WALK_BIGDATA;
+			ni.mni_pages = omp->mp_pages;
+			pi.mpi_pgno = pg;
+			pi.mpi_flags = MDB_WALK_OVERFLOW;
+			pi.mpi_depth = depth + 1;
+			pi.mpi_pages = omp->mp_pages;
+			pi.mpi_nkeys = 1;
+			pi.mpi_used = PAGEHDRSZ + ni.mni_dsize;
+			if (w->mw_page && (rc = w->mw_page(&pi, w->mw_ctx)))
+				return rc;
+		} else if ((node->mn_flags & F_SUBDATA) && w->mw_dupsort) {
+			memcpy(&db, NODEDATA(node), sizeof(db));
+			ni.mni_flags = MDB_WALK_SUBDB;
+			ni.mni_dups = db.md_entries;
+			rc = mdb_walk_page(w, db.md_root, 0, MDB_WALK_SUBDB, &ni.mni_pages);
+			if (rc)
+				return rc;
+		} else if (node->mn_flags & F_DUPDATA) {
+			ni.mni_flags = MDB_WALK_DUPDATA;
+			ni.mni_dups = NUMKEYS((MDB_page *)NODEDATA(node));
+		}
+		if (w->mw_node && (rc = w->mw_node(&ni, w->mw_ctx)))
+			return rc;
+	}
+	return MDB_SUCCESS;
+}
+
+int
+mdb_walk(MDB_txn *txn, MDB_dbi dbi, MDB_walk_page_func *page_func,
+	MDB_walk_node_func *node_func, void *ctx)
+{
+	mdb_walker w;
+
+	if (!TXN_DBI_EXIST(txn, dbi))
+		return EINVAL;
+
+	if (txn->mt_flags & MDB_TXN_ERROR)
+		return MDB_BAD_TXN;
+
+	if (txn->mt_dbflags[dbi] & DB_STALE) {
+		MDB_cursor mc;
+		MDB_xcursor mx;
+		/* Stale, must read the DB's root. cursor_init does it for us. */
+		mdb_cursor_init(&mc, txn, dbi, &mx);
+	}
+	if (txn->mt_dbs[dbi].md_root == P_INVALID)
+		return MDB_SUCCESS;
+
+	w.mw_txn = txn;
+	w.mw_page = page_func;
+	w.mw_node = node_func;
+	w.mw_ctx = ctx;
+	w.mw_dupsort = txn->mt_dbs[dbi].md_flags & MDB_DUPSORT;
+	return mdb_walk_page(&w, txn->mt_dbs[dbi].md_root, 0, 0, NULL);
+}
+
+	/** State of a #mdb_warm() */
+typedef struct mdb_warmer {
+	MDB_txn		*mw_txn;
+	MDB_cmp_func	*mw_cmp;
+	MDB_val		*mw_from;
+	MDB_val		*mw_to;
+	unsigned int	mw_flags;
+	unsigned int	mw_leaf;	/**< depth of the leaf pages */
+	pgno_t		mw_run;		/**< first page of the run to prefetch */
+	pgno_t		mw_len;		/**< length of the run to prefetch */
+	size_t		mw_pages;	/**< number of pages prefetched */
+} mdb_warmer;
+
+	/** Prefetch the pending run of pages. */
+static void
+mdb_warm_flush(mdb_warmer *w)
+{
+	MDB_env *env = w->mw_txn->mt_env;
+	char *ptr = env->me_map + w->mw_run * env->me_psize;
+	size_t len = w->mw_len * env->me_psize, off;
+
+	if (!w->mw_len)
+		return;
+	w->mw_len = 0;
+#if defined(MADV_WILLNEED) || defined(POSIX_MADV_WILLNEED)
+	if (!(w->mw_flags & MDB_WARM_TOUCH)) {
+		/* madvise() wants an address aligned to an OS page */
+		off = (ptr - env->me_map) % env->me_os_psize;
+# ifdef MADV_WILLNEED
+		madvise(ptr - off, len + off, MADV_WILLNEED);
+# else
+		posix_madvise(ptr - off, len + off, POSIX_MADV_WILLNEED);
+# endif
+		return;
+	}
+#endif
+	for (off = 0; off < len; off += env->me_os_psize)
+		(void)*(volatile char *)(ptr + off);
+}
+
+	/** Add pages to the run to prefetch, flushing it if they do not follow it. */
+static void
+mdb_warm_add(mdb_warmer *w, pgno_t pgno, pgno_t count)
+{
+	if (w->mw_len && w->mw_run + w->mw_len == pgno) {
+		w->mw_len += count;
+	} else {
+		mdb_warm_flush(w);
+		w->mw_run = pgno;
+		w->mw_len = count;
+	}
+	w->mw_pages += count;
+}
+
+	/** Check whether the key of a node is in the range of a #mdb_warm().
+	 * @return <0 if before the range, >0 if after it, 0 if in it.
+	 */
+static int
+mdb_warm_cmp(mdb_warmer *w, MDB_node *node)
+{
+	MDB_val key;
+	key.mv_size = NODEKSZ(node);
+	key.mv_data = NODEKEY(node);
+	if (w->mw_from && w->mw_cmp(&key, w->mw_from) < 0)
+		return -1;
+	if (w->mw_to && w->mw_cmp(&key, w->mw_to) > 0)
+		return 1;
+	return 0;
+}
+
+	/** Warm the children of a page which has already been prefetched. */
+static int
+mdb_warm0(mdb_warmer *w, pgno_t pgno, unsigned int depth)
+{
+	MDB_page *mp, *omp;
+	MDB_node *node;
+	pgno_t pg;
+	unsigned int i, nkeys, first, last;
+	int rc;
+
+	if (depth >= CURSOR_STACK)
+		return MDB_CORRUPTED;
+	if ((rc = mdb_page_get(w->mw_txn, pgno, &mp, NULL)))
+		return rc;
+	nkeys = NUMKEYS(mp);
+
+	if (IS_LEAF(mp)) {
+		if (IS_LEAF2(mp))
+			return MDB_SUCCESS;
+		for (i = 0; i < nkeys; i++) {
+			node = NODEPTR(mp, i);
+			if (!(node->mn_flags & F_BIGDATA) || mdb_warm_cmp(w, node))
+				continue;
+			memcpy(&pg, NODEDATA(node), sizeof(pg));
+			if ((rc = mdb_page_get(w->mw_txn, pg, &omp, NULL)))
+				return rc;
+			mdb_warm_add(w, pg, omp->mp_pages);
+		}
+		mdb_warm_flush(w);
+		return MDB_SUCCESS;
+	}
+
+	/* Child i holds the keys from the key of node i up to the key
+	 * of node i+1, the key of node 0 is implicitly the lowest.
+	 */
+	first = 0;
+	last = nkeys - 1;
+	while (first < last && mdb_warm_cmp(w, NODEPTR(mp, first + 1)) < 0)
+		first++;
+	while (last > first && mdb_warm_cmp(w, NODEPTR(mp, last)) > 0)
+		last--;
+
+	/* Prefetch the children in range in one batch, then descend */
+	if (depth + 1 < w->mw_leaf || (w->mw_flags & MDB_WARM_LEAVES)) {
+		for (i = first; i <= last; i++)
+			mdb_warm_add(w, NODEPGNO(NODEPTR(mp, i)), 1);
+		mdb_warm_flush(w);
+	}
+	if (depth + 1 == w->mw_leaf && !(w->mw_flags & MDB_WARM_OVERFLOW))
+		return MDB_SUCCESS;
+	for (i = first; i <= last; i++) {
+		if ((rc = mdb_warm0(w, NODEPGNO(NODEPTR(mp, i)), depth + 1)))
+			return rc;
+	}
+	return MDB_SUCCESS;
+}
+
+int
+mdb_warm(MDB_txn *txn, MDB_dbi dbi, MDB_val *from, MDB_val *to,
+	unsigned int flags, size_t *pages)
+{
+	mdb_warmer w;
+	pgno_t root;
+	int rc = MDB_SUCCESS;
+
+	if (pages)
+		*pages = 0;
+	if (!TXN_DBI_EXIST(txn, dbi) || !(txn->mt_flags & MDB_TXN_RDONLY))
+		return EINVAL;
+
+	if (txn->mt_dbflags[dbi] & DB_STALE) {
+		MDB_cursor mc;
+		MDB_xcursor mx;
+		/* Stale, must read the DB's root. cursor_init does it for us. */
+		mdb_cursor_init(&mc, txn, dbi, &mx);
+	}
+	root = txn->mt_dbs[dbi].md_root;
+	if (root == P_INVALID)
+		return MDB_SUCCESS;
+
+	w.mw_txn = txn;
+	w.mw_cmp = txn->mt_dbxs[dbi].md_cmp;
+	w.mw_from = from;
+	w.mw_to = to;
+	w.mw_flags = flags;
+	w.mw_leaf = txn->mt_dbs[dbi].md_depth - 1;
+	w.mw_len = 0;
+	w.mw_pages = 0;
+
+	if (w.mw_leaf || (flags & (MDB_WARM_LEAVES|MDB_WARM_OVERFLOW))) {
+		mdb_warm_add(&w, root, 1);
+		mdb_warm_flush(&w);
+		if (w.mw_leaf || (flags & MDB_WARM_OVERFLOW))
+			rc = mdb_warm0(&w, root, 0);
+	}
+	if (pages)
+		*pages = w.mw_pages;
+	return rc;
+}
+
 void mdb_dbi_close(MDB_env *env, MDB_dbi dbi)
 {
 	char *ptr;
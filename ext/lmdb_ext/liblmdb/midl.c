@@ -30,6 +30,25 @@
  */
 #define CMP(x,y)	 ( (x) < (y) ? -1 : (x) > (y) )
 
+	/** IDLs at least this long are radix sorted */
+#define MIDL_RADIX	1024
+	/** ID2Ls at least this long are radix sorted, shorter ones
+	 *	are insertion sorted
+	 */
+#define MID2L_RADIX	64
+	/** #mdb_midl_xmerge() gallops when the list is this many
+	 *	times longer than the merge list. Below that the runs it
+	 *	moves at once are too short to pay for finding them, on lists
+	 *	that do not fit in the cache.
+	 */
+#define MIDL_GALLOP	2048
+	/** #mdb_midl_xmerge() merges branch-free only when the list is
+	 *	less than this many times longer than the merge list. A more
+	 *	skewed merge copies long runs of old IDs, whose loop branch the
+	 *	CPU predicts well.
+	 */
+#define MIDL_SKEW	3
+
 unsigned mdb_midl_search( MDB_IDL ids, MDB_ID id )
 {
 	/*
@@ -201,25 +220,113 @@ int mdb_midl_append_range( MDB_IDL *idp, MDB_ID id, unsigned n )
 
 void mdb_midl_xmerge( MDB_IDL idl, MDB_IDL merge )
 {
-	MDB_ID old_id, merge_id, i = merge[0], j = idl[0], k = i+j, total = k;
+	MDB_ID old_id, merge_id, end, i = merge[0], j = idl[0], k, total;
+	if (MDB_IDL_IS_RANGES(merge)) {
+		total = k = j + mdb_midl_count(merge);
+		idl[0] = (MDB_ID)-1;
+		old_id = idl[j];
+		/* Lowest range first, each from its lowest ID */
+		for (i = MDB_IDL_NRANGES(merge) * 2; i; i -= 2) {
+			for (merge_id = merge[i-1], end = merge_id + merge[i]; merge_id < end; merge_id++) {
+				for (; old_id < merge_id; old_id = idl[--j])
+					idl[k--] = old_id;
+				idl[k--] = merge_id;
+			}
+		}
+		idl[0] = total;
+		return;
+	}
+	total = k = i+j;
 	idl[0] = (MDB_ID)-1;		/* delimiter for idl scan below */
-	old_id = idl[j];
+	if (j >= i * MIDL_GALLOP) {
+		MDB_ID lo, hi, step;
+		/* Few IDs into a long list: find each run of old IDs
+		 * below the next merge ID by galloping back from j, and
+		 * move the whole run at once.
+		 */
+		while (i) {
+			merge_id = merge[i--];
+			for (hi = j + 1, lo = j, step = 1; idl[lo] < merge_id; step <<= 1) {
+				hi = lo;
+				lo = lo > step ? lo - step : 0;
+			}
+			while (hi - lo > 1) {
+				MDB_ID x = (lo + hi) >> 1;
+				if (idl[x] < merge_id)
+					hi = x;
+				else
+					lo = x;
+			}
+			k -= j - lo;
+			memmove(idl + k + 1, idl + lo + 1, (j - lo) * sizeof(MDB_ID));
+			j = lo;
+			idl[k--] = merge_id;
+		}
+		idl[0] = total;
+		return;
+	}
+	if (j >= i * MIDL_SKEW) {
+		old_id = idl[j];
+		while (i) {
+			merge_id = merge[i--];
+			for (; old_id < merge_id; old_id = idl[--j])
+				idl[k--] = old_id;
+			idl[k--] = merge_id;
+		}
+		idl[0] = total;
+		return;
+	}
+	/* Branch-free, as which list comes next is unpredictable */
 	while (i) {
-		merge_id = merge[i--];
-		for (; old_id < merge_id; old_id = idl[--j])
-			idl[k--] = old_id;
-		idl[k--] = merge_id;
+		unsigned old = (old_id = idl[j]) < (merge_id = merge[i]);
+		idl[k--] = old ? old_id : merge_id;
+		j -= old;
+		i -= !old;
 	}
 	idl[0] = total;
 }
 
+MDB_ID mdb_midl_count( MDB_IDL ids )
+{
+	MDB_ID i, n;
+	if (!MDB_IDL_IS_RANGES(ids))
+		return ids[0];
+	for (n = 0, i = MDB_IDL_NRANGES(ids) * 2; i; i -= 2)
+		n += ids[i];
+	return n;
+}
+
+unsigned mdb_midl_ranges( MDB_IDL ids )
+{
+	MDB_ID i;
+	unsigned n = ids[0] ? 1 : 0;
+	for (i = 1; i < ids[0]; i++)
+		if (ids[i+1] != ids[i] - 1)
+			n++;
+	return n;
+}
+
+void mdb_midl_encode_ranges( MDB_IDL ids, MDB_IDL dst )
+{
+	MDB_ID i, j = 0, len = ids[0];
+	for (i = 1; i <= len; i++) {
+		if (i == 1 || ids[i] != ids[i-1] - 1) {
+			j += 2;
+			dst[j] = 0;
+		}
+		dst[j-1] = ids[i];
+		dst[j]++;
+	}
+	dst[0] = (j / 2) | MDB_IDL_RANGES;
+}
+
 /* Quicksort + Insertion sort for small arrays */
 
 #define SMALL	8
 #define	MIDL_SWAP(a,b)	{ itmp=(a); (a)=(b); (b)=itmp; }
 
-void
-mdb_midl_sort( MDB_IDL ids )
+static void
+mdb_midl_qsort( MDB_IDL ids )
 {
 	/* Max possible depth of int-indexed tree * 2 items/level */
 	int istack[sizeof(int)*CHAR_BIT * 2];
@@ -279,6 +386,137 @@ mdb_midl_sort( MDB_IDL ids )
 	}
 }
 
+/* LSD radix sort for long lists, RADIX_BITS per pass. Digits that
+ * are the same in every ID are skipped, so lists of page numbers
+ * take two or three passes.
+ */
+
+#define RADIX_BITS	11
+#define RADIX_SIZE	(1 << RADIX_BITS)
+#define RADIX_DIGIT(id, shift)	((unsigned)((id) >> (shift)) & (RADIX_SIZE-1))
+#define RADIX_PASSES	((sizeof(MDB_ID)*CHAR_BIT + RADIX_BITS-1) / RADIX_BITS)
+
+	/** Plan the passes of a radix sort.
+	 * @param[in] diff	The bits that are not the same in every ID.
+	 * @param[out] shifts	The shift of each pass.
+	 * @return	The number of passes.
+	 */
+static int
+mdb_radix_plan( MDB_ID diff, unsigned *shifts )
+{
+	unsigned shift;
+	int n = 0;
+	for (shift = 0; shift < sizeof(MDB_ID)*CHAR_BIT; shift += RADIX_BITS)
+		if (RADIX_DIGIT(diff, shift))
+			shifts[n++] = shift;
+	return n;
+}
+
+void
+mdb_midl_sort( MDB_IDL ids )
+{
+	unsigned shifts[RADIX_PASSES], *count, sum, c;
+	MDB_ID *src, *dst, *tmp, diff = 0, i, n = ids[0];
+	int p, passes;
+
+	if (n < MIDL_RADIX) {
+		mdb_midl_qsort(ids);
+		return;
+	}
+	src = ids + 1;
+	for (i = 1; i < n; i++)
+		diff |= src[i] ^ src[0];
+	passes = mdb_radix_plan(diff, shifts);
+	if (!passes)
+		return;
+	if ((tmp = malloc(n * sizeof(MDB_ID) + passes * RADIX_SIZE * sizeof(unsigned))) == NULL) {
+		mdb_midl_qsort(ids);
+		return;
+	}
+	count = (unsigned *)(tmp + n);
+	memset(count, 0, passes * RADIX_SIZE * sizeof(unsigned));
+	for (i = 0; i < n; i++)
+		for (p = 0; p < passes; p++)
+			count[p * RADIX_SIZE + RADIX_DIGIT(src[i], shifts[p])]++;
+	dst = tmp;
+	for (p = 0; p < passes; p++) {
+		unsigned *off = count + p * RADIX_SIZE, shift = shifts[p];
+		/* Descending: the highest digit goes first */
+		for (sum = 0, c = RADIX_SIZE; c--; ) {
+			unsigned x = off[c];
+			off[c] = sum;
+			sum += x;
+		}
+		for (i = 0; i < n; i++)
+			dst[off[RADIX_DIGIT(src[i], shift)]++] = src[i];
+		src = dst;
+		dst = (src == tmp) ? ids + 1 : tmp;
+	}
+	if (src != ids + 1)
+		memcpy(ids + 1, src, n * sizeof(MDB_ID));
+	free(tmp);
+}
+
+/* Insertion sort for short ID2Ls */
+static void
+mdb_mid2l_isort( MDB_ID2L ids )
+{
+	MDB_ID2 itmp;
+	MDB_ID i, j;
+
+	for (i = 2; i <= ids[0].mid; i++) {
+		itmp = ids[i];
+		for (j = i; j > 1 && ids[j-1].mid > itmp.mid; j--)
+			ids[j] = ids[j-1];
+		ids[j] = itmp;
+	}
+}
+
+void
+mdb_mid2l_sort( MDB_ID2L ids )
+{
+	unsigned shifts[RADIX_PASSES], *count, sum, c;
+	MDB_ID2 *src, *dst, *tmp;
+	MDB_ID diff = 0, i, n = ids[0].mid;
+	int p, passes;
+
+	if (n < MID2L_RADIX) {
+		mdb_mid2l_isort(ids);
+		return;
+	}
+	src = ids + 1;
+	for (i = 1; i < n; i++)
+		diff |= src[i].mid ^ src[0].mid;
+	passes = mdb_radix_plan(diff, shifts);
+	if (!passes)
+		return;
+	if ((tmp = malloc(n * sizeof(MDB_ID2) + passes * RADIX_SIZE * sizeof(unsigned))) == NULL) {
+		mdb_mid2l_isort(ids);
+		return;
+	}
+	count = (unsigned *)(tmp + n);
+	memset(count, 0, passes * RADIX_SIZE * sizeof(unsigned));
+	for (i = 0; i < n; i++)
+		for (p = 0; p < passes; p++)
+			count[p * RADIX_SIZE + RADIX_DIGIT(src[i].mid, shifts[p])]++;
+	dst = tmp;
+	for (p = 0; p < passes; p++) {
+		unsigned *off = count + p * RADIX_SIZE, shift = shifts[p];
+		for (sum = 0, c = 0; c < RADIX_SIZE; c++) {
+			unsigned x = off[c];
+			off[c] = sum;
+			sum += x;
+		}
+		for (i = 0; i < n; i++)
+			dst[off[RADIX_DIGIT(src[i].mid, shift)]++] = src[i];
+		src = dst;
+		dst = (src == tmp) ? ids + 1 : tmp;
+	}
+	if (src != ids + 1)
+		memcpy(ids + 1, src, n * sizeof(MDB_ID2));
+	free(tmp);
+}
+
 unsigned mdb_mid2l_search( MDB_ID2L ids, MDB_ID id )
 {
 	/*
@@ -330,27 +568,17 @@ int mdb_mid2l_insert( MDB_ID2L ids, MDB_ID2 *id )
 		return -1;
 	}
 
-	if ( ids[0].mid >= MDB_IDL_UM_MAX ) {
-		/* too big */
-		return -2;
-
-	} else {
-		/* insert id */
-		ids[0].mid++;
-		for (i=(unsigned)ids[0].mid; i>x; i--)
-			ids[i] = ids[i-1];
-		ids[x] = *id;
-	}
+	/* insert id */
+	ids[0].mid++;
+	for (i=(unsigned)ids[0].mid; i>x; i--)
+		ids[i] = ids[i-1];
+	ids[x] = *id;
 
 	return 0;
 }
 
 int mdb_mid2l_append( MDB_ID2L ids, MDB_ID2 *id )
 {
-	/* Too big? */
-	if (ids[0].mid >= MDB_IDL_UM_MAX) {
-		return -2;
-	}
 	ids[0].mid++;
 	ids[ids[0].mid] = *id;
 	return 0;
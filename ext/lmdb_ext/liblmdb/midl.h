@@ -68,6 +68,15 @@ typedef MDB_ID *MDB_IDL;
 #define MDB_IDL_FIRST( ids )	( (ids)[1] )
 #define MDB_IDL_LAST( ids )		( (ids)[(ids)[0]] )
 
+	/** Set in the counter of an IDL holding ranges instead of IDs.
+	 *	The counter then counts (ID, n) pairs, each the lowest ID of a
+	 *	range and its length, sorted in descending order like IDs.
+	 */
+#define MDB_IDL_RANGES	((MDB_ID)1 << (sizeof(MDB_ID) * 8 - 1))
+#define MDB_IDL_IS_RANGES(ids)	(((ids)[0] & MDB_IDL_RANGES) != 0)
+	/** Number of pairs in an IDL holding ranges */
+#define MDB_IDL_NRANGES(ids)	((ids)[0] & ~MDB_IDL_RANGES)
+
 	/** Current max length of an #mdb_midl_alloc()ed IDL */
 #define MDB_IDL_ALLOCLEN( ids )	( (ids)[-1] )
 
@@ -133,11 +142,30 @@ int mdb_midl_append_range( MDB_IDL *idp, MDB_ID id, unsigned n );
 
 	/** Merge an IDL onto an IDL. The destination IDL must be big enough.
 	 * @param[in] idl	The IDL to merge into.
-	 * @param[in] merge	The IDL to merge.
+	 * @param[in] merge	The IDL to merge, which may hold ranges.
 	 */
 void mdb_midl_xmerge( MDB_IDL idl, MDB_IDL merge );
 
-	/** Sort an IDL.
+	/** Count the IDs in an IDL, which may hold ranges.
+	 * @param[in] ids	The IDL.
+	 * @return	The number of IDs.
+	 */
+MDB_ID mdb_midl_count( MDB_IDL ids );
+
+	/** Count the ranges of consecutive IDs in a sorted IDL.
+	 * @param[in] ids	The IDL.
+	 * @return	The number of ranges.
+	 */
+unsigned mdb_midl_ranges( MDB_IDL ids );
+
+	/** Store a sorted IDL as ranges.
+	 * @param[in] ids	The IDL.
+	 * @param[out] dst	Room for #mdb_midl_ranges() pairs and the counter.
+	 */
+void mdb_midl_encode_ranges( MDB_IDL ids, MDB_IDL dst );
+
+	/** Sort an IDL. Long lists are radix sorted, falling back
+	 * to a quicksort if no scratch memory can be allocated.
 	 * @param[in,out] ids	The IDL to sort.
 	 */
 void mdb_midl_sort( MDB_IDL ids );
@@ -165,6 +193,7 @@ unsigned mdb_mid2l_search( MDB_ID2L ids, MDB_ID id );
 
 
 	/** Insert an ID2 into a ID2L.
+	 * The ID2L must have room for one more ID2.
 	 * @param[in,out] ids	The ID2L to insert into.
 	 * @param[in] id	The ID2 to insert.
 	 * @return	0 on success, -1 if the ID was already present in the ID2L.
@@ -172,12 +201,18 @@ unsigned mdb_mid2l_search( MDB_ID2L ids, MDB_ID id );
 int mdb_mid2l_insert( MDB_ID2L ids, MDB_ID2 *id );
 
 	/** Append an ID2 into a ID2L.
+	 * The ID2L must have room for one more ID2.
 	 * @param[in,out] ids	The ID2L to append into.
 	 * @param[in] id	The ID2 to append.
-	 * @return	0 on success, -2 if the ID2L is too big.
+	 * @return	0 on success.
 	 */
 int mdb_mid2l_append( MDB_ID2L ids, MDB_ID2 *id );
 
+	/** Sort an ID2L by \b mid, e.g. after #mdb_mid2l_append().
+	 * @param[in,out] ids	The ID2L to sort.
+	 */
+void mdb_mid2l_sort( MDB_ID2L ids );
+
 /** @} */
 /** @} */
 #ifdef __cplusplus
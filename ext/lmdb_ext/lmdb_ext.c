@@ -1,12 +1,16 @@
 #include "lmdb_ext.h"
 #include "extconf.h"
+#include "probes.h"
 
 #ifdef HAVE_RB_THREAD_CALL_WITHOUT_GVL2
 
 // ruby 2
 #include "ruby/thread.h"
-#define CALL_WITHOUT_GVL(func, data1, ubf, data2) \
-  rb_thread_call_without_gvl2(func, data1, ubf, data2)
+#define CALL_WITHOUT_GVL(func, data1, ubf, data2) do { \
+  PROBE1(gvl__release, #func); \
+  rb_thread_call_without_gvl2(func, data1, ubf, data2); \
+  PROBE1(gvl__reacquire, #func); \
+} while (0)
 
 #else
 
@@ -15,8 +19,11 @@
 VALUE rb_thread_call_without_gvl(
     rb_blocking_function_t *func, void *data1,
     rb_unblock_function_t *ubf, void *data2);
-#define CALL_WITHOUT_GVL(func, data1, ubf, data2) \
-  rb_thread_call_without_gvl((rb_blocking_function_t *)func, data1, ubf, data2)
+#define CALL_WITHOUT_GVL(func, data1, ubf, data2) do { \
+  PROBE1(gvl__release, #func); \
+  rb_thread_call_without_gvl((rb_blocking_function_t *)func, data1, ubf, data2); \
+  PROBE1(gvl__reacquire, #func); \
+} while (0)
 
 #endif
 
@@ -36,6 +43,98 @@ static void check(int code) {
         rb_raise(cError, "%s", err); /* fallback */
 }
 
+static uint64_t latency_clock(void) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Start timing an operation, returning 0 if the environment does not
+ * record latencies.
+ */
+static uint64_t latency_begin(VALUE venv) {
+        ENVIRONMENT(venv, environment);
+        return environment->latency ? latency_clock() : 0;
+}
+
+static void latency_end(VALUE venv, int op, uint64_t start) {
+        if (!start)
+                return;
+        ENVIRONMENT(venv, environment);
+        if (environment->latency)
+                histogram_record(environment->latency + op, latency_clock() - start);
+}
+
+/*
+ * Map a value to its bucket.  Values below 2^HISTOGRAM_SUB_BITS get a
+ * bucket each, above that every power of two is split into
+ * 2^HISTOGRAM_SUB_BITS linear buckets, which bounds the relative error
+ * to about 3%.
+ */
+static int histogram_bucket(uint64_t v) {
+        int bit = 0;
+        while (bit < 63 && (v >> (bit + 1)))
+                ++bit;
+        if (bit < HISTOGRAM_SUB_BITS)
+                return (int)v;
+        int shift = bit - HISTOGRAM_SUB_BITS;
+        return ((shift + 1) << HISTOGRAM_SUB_BITS) +
+                (int)((v >> shift) & ((1 << HISTOGRAM_SUB_BITS) - 1));
+}
+
+// Highest value that maps to a bucket
+static uint64_t histogram_value(int bucket) {
+        if (bucket < (1 << HISTOGRAM_SUB_BITS))
+                return bucket;
+        int shift = (bucket >> HISTOGRAM_SUB_BITS) - 1;
+        uint64_t low = (uint64_t)((1 << HISTOGRAM_SUB_BITS) +
+                                  (bucket & ((1 << HISTOGRAM_SUB_BITS) - 1))) << shift;
+        return low + (((uint64_t)1 << shift) - 1);
+}
+
+static void histogram_record(Histogram* histogram, uint64_t v) {
+        if (!histogram->count || v < histogram->min)
+                histogram->min = v;
+        if (v > histogram->max)
+                histogram->max = v;
+        ++histogram->count;
+        histogram->sum += v;
+        ++histogram->buckets[histogram_bucket(v)];
+}
+
+static VALUE histogram_report(const Histogram* histogram) {
+        static const struct { const char* name; double quantile; } percentiles[] = {
+                { "p50", 0.5 }, { "p90", 0.9 }, { "p99", 0.99 }, { "p999", 0.999 }
+        };
+
+        VALUE ret = rb_hash_new();
+        rb_hash_aset(ret, ID2SYM(rb_intern("count")), ULL2NUM(histogram->count));
+        rb_hash_aset(ret, ID2SYM(rb_intern("min")), DBL2NUM(histogram->min / 1e9));
+        rb_hash_aset(ret, ID2SYM(rb_intern("max")), DBL2NUM(histogram->max / 1e9));
+        rb_hash_aset(ret, ID2SYM(rb_intern("mean")),
+                     DBL2NUM((double)histogram->sum / histogram->count / 1e9));
+
+        size_t i;
+        int bucket = 0;
+        uint64_t seen = histogram->buckets[0];
+        for (i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); ++i) {
+                uint64_t rank = (uint64_t)(percentiles[i].quantile * histogram->count + 0.999999);
+                if (rank < 1)
+                        rank = 1;
+                while (seen < rank && bucket < HISTOGRAM_BUCKETS - 1)
+                        seen += histogram->buckets[++bucket];
+                uint64_t v = histogram_value(bucket);
+                if (v > histogram->max)
+                        v = histogram->max;
+                if (v < histogram->min)
+                        v = histogram->min;
+                rb_hash_aset(ret, ID2SYM(rb_intern(percentiles[i].name)), DBL2NUM(v / 1e9));
+        }
+
+        return ret;
+}
+
 static void transaction_free(Transaction* transaction) {
         if (transaction->txn) {
                 rb_warn("Memory leak - Garbage collecting active transaction");
@@ -121,6 +220,49 @@ static VALUE transaction_env(VALUE self) {
         return transaction->env;
 }
 
+#ifdef MDB_COMMIT_LATENCY
+/**
+ * @overload commit_stats
+ *   Return the time spent in the phases of the commit of this
+ *   transaction.  Read-only and child transactions only report a
+ *   +:total+.
+ *   @return [Hash, nil] the phase durations in seconds, or +nil+ if the
+ *       transaction has not been committed
+ *   * +:prepare+ Updating the records of changed named databases
+ *   * +:freelist+ Saving the list of freed pages
+ *   * +:write+ Writing the dirty pages to the file
+ *   * +:sync+ Flushing the data pages to disk
+ *   * +:meta+ Writing and flushing the meta page
+ *   * +:total+ The whole commit
+ *   @example
+ *      txn = nil
+ *      env.transaction do |t|
+ *        txn = t
+ *        db['key'] = 'value'
+ *      end
+ *      txn.commit_stats[:sync]
+ */
+static VALUE transaction_commit_stats(VALUE self) {
+        TRANSACTION(self, transaction);
+
+        if (!transaction->committed)
+                return Qnil;
+
+        VALUE ret = rb_hash_new();
+
+#define LATENCY_SET(name) rb_hash_aset(ret, ID2SYM(rb_intern(#name)), DBL2NUM(transaction->latency.mcl_##name / 1e6));
+        LATENCY_SET(prepare);
+        LATENCY_SET(freelist);
+        LATENCY_SET(write);
+        LATENCY_SET(sync);
+        LATENCY_SET(meta);
+        LATENCY_SET(total);
+#undef LATENCY_SET
+
+        return ret;
+}
+#endif
+
 static void transaction_finish(VALUE self, int commit) {
         TRANSACTION(self, transaction);
 
@@ -140,10 +282,20 @@ static void transaction_finish(VALUE self, int commit) {
                 rb_raise(cError, "Transaction is not active");
 
         int ret = 0;
+        uint64_t start = (transaction->flags & MDB_RDONLY) ? 0 : latency_begin(transaction->env);
+#ifdef MDB_COMMIT_LATENCY
+        if (commit) {
+                ret = mdb_txn_commit_ex(transaction->txn, &transaction->latency);
+                transaction->committed = !ret;
+        }
+#else
         if (commit)
                 ret = mdb_txn_commit(transaction->txn);
+#endif
         else
                 mdb_txn_abort(transaction->txn);
+        if (commit)
+                latency_end(transaction->env, LATENCY_commit, start);
 
         long i;
         for (i=0; i<RARRAY_LEN(transaction->cursors); i++) {
@@ -174,7 +326,12 @@ static VALUE call_with_transaction_helper(VALUE arg) {
 #else
 static VALUE call_with_transaction_helper(VALUE arg) {
         HelperArgs* a = (HelperArgs*)arg;
+#ifdef HAVE_RB_FUNCALL_PASSING_BLOCK_KW
+        // Keyword arguments are forwarded only if they are passed explicitly
+        return rb_funcall_passing_block_kw(a->self, rb_intern(a->name), a->argc, a->argv, RB_PASS_CALLED_KEYWORDS);
+#else
         return rb_funcall_passing_block(a->self, rb_intern(a->name), a->argc, a->argv);
+#endif
 }
 #endif
 
@@ -185,6 +342,7 @@ static VALUE call_with_transaction(VALUE venv, VALUE self, const char* name, int
 
 static void *call_txn_begin(void *arg) {
         TxnArgs *txn_args = arg;
+        uint64_t start = txn_args->timed ? latency_clock() : 0;
         txn_args->result = mdb_txn_begin(txn_args->env,
           txn_args->parent, txn_args->flags, txn_args->htxn);
         if (txn_args->result == MDB_MAP_RESIZED) {
@@ -192,6 +350,8 @@ static void *call_txn_begin(void *arg) {
             txn_args->result = mdb_txn_begin(txn_args->env,
               txn_args->parent, txn_args->flags, txn_args->htxn);
         }
+        if (txn_args->timed)
+                txn_args->elapsed = latency_clock() - start;
         return (void *)NULL;
 }
 
@@ -219,6 +379,8 @@ static VALUE with_transaction(VALUE venv, VALUE(*fn)(VALUE), VALUE arg, int flag
         txn_args.htxn = &txn;
         txn_args.result = 0;
         txn_args.stop = 0;
+        txn_args.timed = environment->latency != NULL;
+        txn_args.elapsed = 0;
 
         if (flags & MDB_RDONLY) {
                 call_txn_begin(&txn_args);
@@ -240,12 +402,15 @@ static VALUE with_transaction(VALUE venv, VALUE(*fn)(VALUE), VALUE arg, int flag
         }
 
         check(txn_args.result);
+        if (environment->latency)
+                histogram_record(environment->latency + LATENCY_begin, txn_args.elapsed);
 
         Transaction* transaction;
         VALUE vtxn = Data_Make_Struct(cTransaction, Transaction, transaction_mark, transaction_free, transaction);
         transaction->parent = environment_active_txn(venv);
         transaction->env = venv;
         transaction->txn = txn;
+        transaction->flags = flags;
         transaction->thread = rb_thread_current();
         transaction->cursors = rb_ary_new();
         environment_set_active_txn(venv, transaction->thread, vtxn);
@@ -263,6 +428,249 @@ static VALUE with_transaction(VALUE venv, VALUE(*fn)(VALUE), VALUE arg, int flag
         return ret;
 }
 
+#ifdef MDB_WAIT_FOREVER
+static void *call_wait_commit(void *arg) {
+        WaitArgs *wait_args = arg;
+        wait_args->result = mdb_env_wait_commit(wait_args->env,
+          wait_args->txnid, wait_args->msec, &wait_args->last);
+        return (void *)NULL;
+}
+
+static double monotonic_time(void) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @overload wait_for_commit(txnid, timeout: nil)
+ *   Block until a transaction newer than +txnid+ has been committed to
+ *   the environment by any process.  The global VM lock is released while
+ *   waiting, and on Linux the waiter sleeps on a futex in the lock file
+ *   that committers signal, so there is no polling.
+ *   @param [Integer] txnid The last transaction id seen by the caller,
+ *       e.g. +info[:last_txnid]+.
+ *   @param [Numeric] timeout Maximum number of seconds to wait, or +nil+
+ *       to wait forever.
+ *   @return [Integer, nil] The id of the last committed transaction, or
+ *       +nil+ if the timeout expired first.
+ *   @example Invalidate a cache on every commit
+ *      last = env.info[:last_txnid]
+ *      loop do
+ *        last = env.wait_for_commit(last)
+ *        cache.clear
+ *      end
+ */
+static VALUE environment_wait_for_commit(int argc, VALUE *argv, VALUE self) {
+        ENVIRONMENT(self, environment);
+
+        VALUE vtxnid, option_hash, vtimeout = Qnil;
+        rb_scan_args(argc, argv, "1:", &vtxnid, &option_hash);
+        if (!NIL_P(option_hash))
+                vtimeout = rb_hash_aref(option_hash, ID2SYM(rb_intern("timeout")));
+
+        double deadline = NIL_P(vtimeout) ? 0 : monotonic_time() + NUM2DBL(vtimeout);
+
+        WaitArgs wait_args;
+        wait_args.env = environment->env;
+        wait_args.txnid = NUM2SIZET(vtxnid);
+
+        for (;;) {
+                // The wait returns EINTR when the thread is interrupted
+                wait_args.msec = MDB_WAIT_FOREVER;
+                if (!NIL_P(vtimeout)) {
+                        // Round up, so that the wait does not end before the deadline
+                        double left = (deadline - monotonic_time()) * 1000;
+                        if (left <= 0)
+                                wait_args.msec = 0;
+                        else if (left < MDB_WAIT_FOREVER - 1)
+                                wait_args.msec = (unsigned int)left + 1;
+                        else
+                                wait_args.msec = MDB_WAIT_FOREVER - 1;
+                }
+                wait_args.result = EINTR;
+
+                CALL_WITHOUT_GVL(call_wait_commit, &wait_args, RUBY_UBF_IO, 0);
+
+                if (wait_args.result == 0)
+                        return SIZET2NUM(wait_args.last);
+                if (wait_args.result == ETIMEDOUT) {
+                        if (!NIL_P(vtimeout) && monotonic_time() >= deadline)
+                                return Qnil;
+                } else if (wait_args.result != EINTR) {
+                        check(wait_args.result);
+                }
+                rb_thread_check_ints();
+        }
+}
+#endif
+
+#ifdef MDB_WARM_LEAVES
+static void *call_warm(void *arg) {
+        WarmArgs *warm_args = arg;
+        MDB_txn *txn;
+        size_t pages;
+        int i;
+        warm_args->pages = 0;
+        warm_args->result = 0;
+        txn = warm_args->txn;
+        if (!txn) {
+                warm_args->result = mdb_txn_begin(warm_args->env, 0, MDB_RDONLY, &txn);
+                if (warm_args->result)
+                        return (void *)NULL;
+        }
+        if (!warm_args->dbis) {
+                // Main database
+                MDB_dbi dbi;
+                warm_args->result = mdb_dbi_open(txn, 0, 0, &dbi);
+                if (!warm_args->result)
+                        warm_args->result = mdb_warm(txn, dbi,
+                          warm_args->from, warm_args->to, warm_args->flags, &warm_args->pages);
+        }
+        for (i = 0; i < warm_args->ndbs && !warm_args->result; ++i) {
+                warm_args->result = mdb_warm(txn, warm_args->dbis[i],
+                  warm_args->from, warm_args->to, warm_args->flags, &pages);
+                warm_args->pages += pages;
+        }
+        if (!warm_args->txn)
+                mdb_txn_abort(txn);
+        return (void *)NULL;
+}
+
+static VALUE warm_thread(void* arg) {
+        VALUE args = (VALUE)arg;
+        return warm(rb_ary_entry(args, 0), rb_ary_entry(args, 1));
+}
+
+/**
+ * @overload warm(db: nil, levels: :branches, range: nil, touch: false, background: false)
+ *   Bring the pages of databases into the operating system's page cache,
+ *   to avoid the page faults of a cold start.  The pages are prefetched
+ *   with +madvise(MADV_WILLNEED)+ one level of the B-tree at a time, so
+ *   the operating system can read each level in parallel.  The global VM
+ *   lock is released while warming.  Inside a read-only transaction,
+ *   the pages of its snapshot are warmed.
+ *   @param [Database, Array<Database>] db The databases to warm, the main
+ *       database by default.
+ *   @param [Symbol] levels The pages to warm: +:branches+ for the branch
+ *       pages only, which is usually enough to make every lookup cost a
+ *       single read, +:leaves+ to also warm the leaf pages, or +:all+ to
+ *       also warm the overflow pages of large values.
+ *   @param [Range] range Only warm the pages of the keys in this range.
+ *       The end of the range is always included.
+ *   @param [Boolean] touch Read the pages instead of asking the operating
+ *       system to prefetch them, so they are resident when this returns.
+ *   @param [Boolean] background Warm in a new thread.  The environment
+ *       waits for it when it is closed.
+ *   @return [Integer, Thread] The number of pages warmed, or the thread
+ *       warming them, whose value is that number.
+ *   @example Warm the index at startup while serving requests
+ *      env.warm(db: [users, sessions], background: true)
+ *   @example Warm a hot key range completely
+ *      env.warm(db: users, levels: :all, range: 'user:1000'..'user:2000')
+ */
+static VALUE environment_warm(int argc, VALUE *argv, VALUE self) {
+        ENVIRONMENT(self, environment);
+
+        VALUE option_hash;
+        rb_scan_args(argc, argv, ":", &option_hash);
+        if (NIL_P(option_hash) || !RTEST(rb_hash_aref(option_hash, ID2SYM(rb_intern("background")))))
+                return warm(self, option_hash);
+
+        VALUE args = rb_ary_new3(2, self, option_hash);
+        VALUE thread = rb_thread_create(warm_thread, (void*)args);
+        // The thread does not mark its argument
+        rb_ivar_set(thread, rb_intern("lmdb_warm"), args);
+        long i;
+        for (i = RARRAY_LEN(environment->warmers) - 1; i >= 0; --i) {
+                VALUE warmer = rb_ary_entry(environment->warmers, i);
+                if (!RTEST(rb_funcall(warmer, rb_intern("alive?"), 0)))
+                        rb_ary_delete_at(environment->warmers, i);
+        }
+        rb_ary_push(environment->warmers, thread);
+        return thread;
+}
+
+static VALUE warm(VALUE self, VALUE option_hash) {
+        ENVIRONMENT(self, environment);
+
+        VALUE vdb = Qnil, vlevels = Qnil, vrange = Qnil;
+        if (!NIL_P(option_hash)) {
+                vdb = rb_hash_aref(option_hash, ID2SYM(rb_intern("db")));
+                vlevels = rb_hash_aref(option_hash, ID2SYM(rb_intern("levels")));
+                vrange = rb_hash_aref(option_hash, ID2SYM(rb_intern("range")));
+        }
+
+        WarmArgs warm_args;
+        warm_args.env = environment->env;
+        // Reuse the read transaction of this thread rather than take a
+        // second reader slot, which may conflict with it or be the last
+        warm_args.txn = 0;
+        VALUE vtxn = environment_active_txn(self);
+        if (!NIL_P(vtxn)) {
+                TRANSACTION(vtxn, transaction);
+                if (transaction->flags & MDB_RDONLY)
+                        warm_args.txn = active_txn(self);
+        }
+        warm_args.flags = 0;
+        if (!NIL_P(option_hash) && RTEST(rb_hash_aref(option_hash, ID2SYM(rb_intern("touch")))))
+                warm_args.flags |= MDB_WARM_TOUCH;
+
+        if (NIL_P(vlevels) || vlevels == ID2SYM(rb_intern("branches")))
+                ;
+        else if (vlevels == ID2SYM(rb_intern("leaves")))
+                warm_args.flags |= MDB_WARM_LEAVES;
+        else if (vlevels == ID2SYM(rb_intern("all")))
+                warm_args.flags |= MDB_WARM_LEAVES | MDB_WARM_OVERFLOW;
+        else
+                rb_raise(rb_eArgError, "levels must be :branches, :leaves or :all");
+
+        // A null list of databases means the main database
+        warm_args.dbis = 0;
+        warm_args.ndbs = 0;
+        if (!NIL_P(vdb)) {
+                long i;
+                // Not rb_Array, a database is enumerable
+                if (TYPE(vdb) != T_ARRAY)
+                        vdb = rb_ary_new3(1, vdb);
+                warm_args.ndbs = RARRAY_LEN(vdb);
+                MDB_dbi* dbis = ALLOCA_N(MDB_dbi, warm_args.ndbs + 1);
+                for (i = 0; i < warm_args.ndbs; ++i) {
+                        DATABASE(rb_ary_entry(vdb, i), database);
+                        dbis[i] = database->dbi;
+                }
+                warm_args.dbis = dbis;
+        }
+
+        MDB_val from, to;
+        VALUE vfrom = Qnil, vto = Qnil;
+        int excl;
+        warm_args.from = warm_args.to = 0;
+        if (!NIL_P(vrange)) {
+                if (!rb_range_values(vrange, &vfrom, &vto, &excl))
+                        rb_raise(rb_eArgError, "range must be a Range");
+                if (!NIL_P(vfrom)) {
+                        vfrom = StringValue(vfrom);
+                        from.mv_size = RSTRING_LEN(vfrom);
+                        from.mv_data = RSTRING_PTR(vfrom);
+                        warm_args.from = &from;
+                }
+                if (!NIL_P(vto)) {
+                        vto = StringValue(vto);
+                        to.mv_size = RSTRING_LEN(vto);
+                        to.mv_data = RSTRING_PTR(vto);
+                        warm_args.to = &to;
+                }
+        }
+
+        CALL_WITHOUT_GVL(call_warm, &warm_args, RUBY_UBF_IO, 0);
+        RB_GC_GUARD(vfrom);
+        RB_GC_GUARD(vto);
+        check(warm_args.result);
+        return SIZET2NUM(warm_args.pages);
+}
+#endif
+
 static void environment_check(Environment* environment) {
         if (!environment->env)
                 rb_raise(cError, "Environment is closed");
@@ -279,6 +687,7 @@ static void environment_free(Environment *environment) {
                 }
                 mdb_env_close(environment->env);
         }
+        xfree(environment->latency);
         free(environment);
 }
 
@@ -286,6 +695,7 @@ static void environment_free(Environment *environment) {
 static void environment_mark(Environment* environment) {
         rb_gc_mark(environment->thread_txn_hash);
         rb_gc_mark(environment->txn_thread_hash);
+        rb_gc_mark(environment->warmers);
 }
 
 /**
@@ -299,6 +709,9 @@ static void environment_mark(Environment* environment) {
  */
 static VALUE environment_close(VALUE self) {
         ENVIRONMENT(self, environment);
+        // Background warm-ups hold a read transaction, let them finish
+        while (RARRAY_LEN(environment->warmers) > 0)
+                rb_funcall(rb_ary_shift(environment->warmers), rb_intern("join"), 0);
         mdb_env_close(environment->env);
         environment->env = 0;
         return Qnil;
@@ -357,6 +770,8 @@ static VALUE environment_stat(VALUE self) {
  *   * +:last_txnid+ ID of the last committed transaction
  *   * +:maxreaders+ Max reader slots in the environment
  *   * +:numreaders+ Max readers slots in the environment
+ *   * +:maxdirty+ Max dirty pages of a write transaction before some are spilled
+ *   * +:writers+ Threads writing the pages of large commits
  */
 static VALUE environment_info(VALUE self) {
         MDB_envinfo info;
@@ -373,11 +788,198 @@ static VALUE environment_info(VALUE self) {
         INFO_SET(last_txnid);
         INFO_SET(maxreaders);
         INFO_SET(numreaders);
+#ifdef MDB_MAXDIRTY_MIN
+        INFO_SET(maxdirty);
+#endif
+#ifdef MDB_WRITERS_MAX
+        INFO_SET(writers);
+#endif
 #undef INFO_SET
 
         return ret;
 }
 
+#ifdef MDB_METRICS_RESET
+/**
+ * @overload metrics(reset = false)
+ *   Return the performance counters of the storage engine.  The counters
+ *   cover the write transactions of this process since the environment
+ *   was opened or last reset.  They are read without the writer lock, so
+ *   they are approximate while another thread is writing, and a reset may
+ *   lose the counts of its transaction.
+ *   @param [Boolean] reset Reset the counters to zero after reading them
+ *   @return [Hash]
+ *   * +:alloc_freelist+ Pages allocated from the freelist
+ *   * +:alloc_extend+ Pages allocated by growing the file
+ *   * +:alloc_loose+ Loose pages reused within a transaction
+ *   * +:freedb_reads+ Records read from the free database
+ *   * +:spills+ Number of times dirty pages were spilled
+ *   * +:spill_pages+ Dirty pages spilled to the map
+ *   * +:unspill_pages+ Spilled pages copied back to be written again
+ *   * +:flush_pages+ Pages written at commit or by spills, which also
+ *     count them in +:spill_pages+
+ *   * +:flush_bytes+ Bytes written at commit or by spills
+ *   * +:flush_writes+ Write system calls issued at commit or by spills
+ *   * +:freelist_records+ Records written to the free database
+ *   * +:freelist_pages+ Page numbers stored in those records
+ *   * +:splits+ Page splits
+ *   * +:merges+ Page merges
+ *   * +:extent_hits+ Multi-page allocations served by the free-extent index
+ *   * +:extent_rebuilds+ Rebuilds of the free-extent index
+ *   * +:dirty_hash_builds+ Builds of the hash index of a transaction's
+ *     dirty pages, used once it holds many of them
+ *   * +:arena_chunks+ Memory chunks mapped for the dirty pages of write
+ *     transactions, a few of which are kept between transactions
+ *   * +:reader_scans+ Scans of the reader table for the oldest snapshot
+ *     still in use, done at most once per transaction and per 256 pages
+ *     the file grows by
+ *   * +:single_syncs+ Commits made durable with a single flush, see the
+ *     +:singlesync+ option
+ *   * +:uring_flushes+ Page flushes submitted through io_uring, see the
+ *     +:iouring+ option
+ *   * +:writer_flushes+ Page flushes split between writer threads, see the
+ *     +:writers+ option
+ */
+static VALUE environment_metrics(int argc, VALUE *argv, VALUE self) {
+        MDB_metrics metrics;
+        VALUE reset;
+
+        rb_scan_args(argc, argv, "01", &reset);
+
+        ENVIRONMENT(self, environment);
+        check(mdb_env_metrics(environment->env, &metrics,
+                              RTEST(reset) ? MDB_METRICS_RESET : 0));
+
+        VALUE ret = rb_hash_new();
+
+#define METRIC_SET(name) rb_hash_aset(ret, ID2SYM(rb_intern(#name)), SIZET2NUM(metrics.mx_##name));
+        METRIC_SET(alloc_freelist);
+        METRIC_SET(alloc_extend);
+        METRIC_SET(alloc_loose);
+        METRIC_SET(freedb_reads);
+        METRIC_SET(spills);
+        METRIC_SET(spill_pages);
+        METRIC_SET(unspill_pages);
+        METRIC_SET(flush_pages);
+        METRIC_SET(flush_bytes);
+        METRIC_SET(flush_writes);
+        METRIC_SET(freelist_records);
+        METRIC_SET(freelist_pages);
+        METRIC_SET(splits);
+        METRIC_SET(merges);
+        METRIC_SET(extent_hits);
+        METRIC_SET(extent_rebuilds);
+        METRIC_SET(dirty_hash_builds);
+        METRIC_SET(arena_chunks);
+        METRIC_SET(reader_scans);
+        METRIC_SET(single_syncs);
+        METRIC_SET(uring_flushes);
+        METRIC_SET(writer_flushes);
+#undef METRIC_SET
+
+        return ret;
+}
+#endif
+
+/**
+ * @overload latency_report(reset = false)
+ *   Return the latency distribution of the operations done through this
+ *   environment since it was opened or last reset.  The time is measured
+ *   around the calls into LMDB, so it excludes Ruby overhead such as
+ *   argument conversion and garbage collection.  The environment must
+ *   have been opened with +:latency+.
+ *   @param [Boolean] reset Clear the histograms after reading them
+ *   @return [Hash] A hash from operation to its statistics, for the
+ *       operations which were recorded at least once.  The operations
+ *       are +:get+, +:put+, +:delete+, +:cursor_get+, +:cursor_put+,
+ *       +:cursor_delete+, +:begin+ (including the wait for the writer
+ *       lock) and +:commit+ (write transactions only).  The statistics
+ *       are +:count+ and +:min+, +:max+, +:mean+, +:p50+, +:p90+,
+ *       +:p99+ and +:p999+ in seconds.  Percentiles are accurate to
+ *       about 3%.
+ *   @raise [Error] if latency recording is not enabled.
+ *   @example
+ *      env = LMDB.new(path, :latency => true)
+ *      # ...
+ *      env.latency_report[:commit][:p99]
+ */
+static VALUE environment_latency_report(int argc, VALUE *argv, VALUE self) {
+        VALUE reset;
+        rb_scan_args(argc, argv, "01", &reset);
+
+        ENVIRONMENT(self, environment);
+        if (!environment->latency)
+                rb_raise(cError, "Latency recording is not enabled");
+
+        VALUE ret = rb_hash_new();
+#define OP(name) \
+        if (environment->latency[LATENCY_##name].count) \
+                rb_hash_aset(ret, ID2SYM(rb_intern(#name)), histogram_report(environment->latency + LATENCY_##name));
+#include "latency_ops.h"
+#undef OP
+
+        if (RTEST(reset))
+                MEMZERO(environment->latency, Histogram, LATENCY_OPS);
+
+        return ret;
+}
+
+#ifdef MDB_WALK_LEAF
+/*
+ * Return a string of one byte per page of the data file up to the last
+ * used page, 1 if the page is in the page cache. For lookups by page
+ * number; counts over the whole file use residency_count.
+ */
+static VALUE residency_vector(MDB_env* env, size_t* npages) {
+        MDB_envinfo info;
+        check(mdb_env_info(env, &info));
+        *npages = info.me_last_pgno + 1;
+        VALUE vec = rb_str_new(0, *npages);
+        check(mdb_env_mincore(env, 0, *npages, (unsigned char*)RSTRING_PTR(vec)));
+        return vec;
+}
+
+/*
+ * Count the pages of the data file up to the last used page that are in
+ * the page cache, checking RESIDENCY_CHUNK pages at a time.
+ */
+static size_t residency_count(MDB_env* env, size_t* npages) {
+        MDB_envinfo info;
+        unsigned char vec[RESIDENCY_CHUNK];
+        size_t first, n, i, resident = 0;
+        check(mdb_env_info(env, &info));
+        *npages = info.me_last_pgno + 1;
+        for (first = 0; first < *npages; first += n) {
+                n = *npages - first < RESIDENCY_CHUNK ? *npages - first : RESIDENCY_CHUNK;
+                check(mdb_env_mincore(env, first, n, vec));
+                for (i = 0; i < n; ++i)
+                        resident += vec[i];
+        }
+        return resident;
+}
+
+static VALUE residency_hash(size_t pages, size_t resident) {
+        VALUE ret = rb_hash_new();
+        rb_hash_aset(ret, ID2SYM(rb_intern("pages")), SIZET2NUM(pages));
+        rb_hash_aset(ret, ID2SYM(rb_intern("resident")), SIZET2NUM(resident));
+        return ret;
+}
+
+/**
+ * @overload residency
+ *   Report how much of the data file is in the operating system's page
+ *   cache, as seen by +mincore+ on the memory map.  See
+ *   {Database#residency} for a breakdown by page type.
+ *   @return [Hash] the number of +:pages+ in use in the data file and
+ *       how many of them are +:resident+
+ */
+static VALUE environment_residency(VALUE self) {
+        ENVIRONMENT(self, environment);
+        size_t npages, resident = residency_count(environment->env, &npages);
+        return residency_hash(npages, resident);
+}
+#endif
+
 /**
  * @overload copy(path)
  *   Create a copy (snapshot) of an environment.  The copy can be used
@@ -429,8 +1031,24 @@ static int environment_options(VALUE key, VALUE value, EnvironmentOptions* optio
                 options->maxreaders = NUM2INT(value);
         else if (id == rb_intern("maxdbs"))
                 options->maxdbs = NUM2INT(value);
+        else if (id == rb_intern("maxdirty"))
+#ifdef MDB_MAXDIRTY_MIN
+                options->maxdirty = NUM2INT(value);
+#else
+                rb_raise(rb_eNotImpError, "Option :maxdirty is not supported by this LMDB");
+#endif
+        else if (id == rb_intern("writers"))
+#ifdef MDB_WRITERS_MAX
+                options->writers = NUM2INT(value);
+#else
+                rb_raise(rb_eNotImpError, "Option :writers is not supported by this LMDB");
+#endif
         else if (id == rb_intern("mapsize"))
                 options->mapsize = NUM2SSIZET(value);
+        else if (id == rb_intern("changelog"))
+                options->changelog = RTEST(value);
+        else if (id == rb_intern("latency"))
+                options->latency = RTEST(value);
 
 #define FLAG(const, name) else if (id == rb_intern(#name)) { if (RTEST(value)) { options->flags |= MDB_##const; } }
 #include "env_flags.h"
@@ -462,11 +1080,31 @@ static int environment_options(VALUE key, VALUE value, EnvironmentOptions* optio
  *       that can be executing transactions at once.  Default is 126.
  *   @option opts [Number] :maxdbs The maximum number of named databases in the
  *       environment.  Not needed if only one database is being used.
+ *   @option opts [Number] :maxdirty The maximum number of pages a write
+ *       transaction keeps in memory before spilling some of them to the
+ *       map.  Default is 131071.  Raise it for huge batch transactions.
+ *       The list of dirty pages only grows when a transaction needs it, and
+ *       then keeps its size until the environment is closed.  See the
+ *       +:spills+ counter of {Environment#metrics}.  Raises
+ *       NotImplementedError when built against an LMDB without it.
+ *   @option opts [Number] :writers The number of threads writing the dirty
+ *       pages of large commits, up to 16.  Default is 1.  Commits of tens of
+ *       thousands of pages are split into runs of at least 4096 pages written
+ *       concurrently before the sync, which helps bulk loads on fast SSDs.
+ *       See the +:writer_flushes+ counter of {Environment#metrics}.
+ *       Raises NotImplementedError when built against an LMDB without it.
  *   @option opts [Number] :mapsize The size of the memory map to be allocated
  *       for this environment, in bytes.  The memory map size is the
  *       maximum total size of the database.  The size should be a
  *       multiple of the OS page size.  The default size is about
  *       10MiB.
+ *   @option opts [Boolean] :changelog Record every mutation made through
+ *       this binding in an internal database, atomically with the data.
+ *       See {Environment#changes_since}.  The changelog is a named
+ *       database, so it shows up as the key +__changelog+ in the main database.
+ *   @option opts [Boolean] :latency Record the latency of every database,
+ *       cursor and transaction operation in histograms.
+ *       See {Environment#latency_report}.
  *   @yield [env] The block to be executed with the environment. The environment is closed afterwards.
  *   @yieldparam env [Environment] The environment
  *   @see #close
@@ -500,16 +1138,33 @@ static VALUE environment_new(int argc, VALUE *argv, VALUE klass) {
         environment->env = env;
         environment->thread_txn_hash = rb_hash_new();
         environment->txn_thread_hash = rb_hash_new();
+        environment->warmers = rb_ary_new();
+        environment->changelog = 0;
 
         if (options.maxreaders > 0)
                 check(mdb_env_set_maxreaders(env, options.maxreaders));
         if (options.mapsize > 0)
                 check(mdb_env_set_mapsize(env, options.mapsize));
+#ifdef MDB_MAXDIRTY_MIN
+        if (options.maxdirty > 0)
+                check(mdb_env_set_maxdirty(env, options.maxdirty));
+#endif
+#ifdef MDB_WRITERS_MAX
+        if (options.writers > 0)
+                check(mdb_env_set_writers(env, options.writers));
+#endif
 
         check(mdb_env_set_maxdbs(env, options.maxdbs <= 0 ? 1 : options.maxdbs));
         VALUE expanded_path = rb_file_expand_path(path, Qnil);
         check(mdb_env_open(env, StringValueCStr(expanded_path), options.flags, options.mode));
 
+        if (options.changelog)
+                changelog_open(environment, options.flags);
+        if (options.latency) {
+                environment->latency = ALLOC_N(Histogram, LATENCY_OPS);
+                MEMZERO(environment->latency, Histogram, LATENCY_OPS);
+        }
+
         if (rb_block_given_p())
                 return rb_ensure(rb_yield, venv, environment_close, venv);
 
@@ -529,6 +1184,10 @@ static VALUE environment_new(int argc, VALUE *argv, VALUE klass) {
  *   * +:writemap+ Use a writeable memory map unless +:rdonly+ is set. This is faster and uses fewer mallocs, but loses protection from application bugs like wild pointer writes and other bad updates into the database. Incompatible with nested transactions.
  *   * +:mapasync+ When using +:writemap+, use asynchronous flushes to disk. As with +:nosync+, a system crash can then corrupt the database or lose the last transactions. Calling {Environment#sync} ensures on-disk database integrity until next commit.
  *   * +:notls+ Don't use thread-local storage.
+ *   * +:mappopulate+ Read the whole data file into the page cache when opening the environment (Linux only). This removes the page faults of a cold start, but it reads the whole map, so it is harmful when the database is larger than memory. See {Environment#warm} for a targeted warm-up.
+ *   * +:freeranges+ Save the pages freed by a transaction as ranges when that is smaller, which keeps the free list small after deleting many records or large values. Once ranges have been saved, versions of LMDB without this option refuse to open the file, even after the option is turned off again.
+ *   * +:singlesync+ Make each commit durable with one flush to disk instead of two. The meta page is written along with the data pages and carries their checksums, and opening the environment after a crash falls back to the previous transaction if the last one did not fully reach the disk. Commits that spilled pages or that write many separate runs of pages still flush twice. No effect with +:nosync+ or +:writemap+.
+ *   * +:iouring+ Write the dirty pages of a commit through an io_uring, all queued at once and followed by the sync, so that the device sees many writes in flight (Linux 5.4 or later). Where io_uring is not available the pages are written as without this option. No effect with +:writemap+. With +:writers+ above 1, a commit large enough to be split between the writer threads does not use the ring and runs its own sync.
  *   @example
  *       env = LMDB.new "abc", :writemap => true, :nometasync => true
  *       env.flags           #=> [:writemap, :nometasync]
@@ -611,6 +1270,37 @@ static VALUE environment_clear_flags(int argc, VALUE* argv, VALUE self) {
         return Qnil;
 }
 
+#ifdef MDB_ADVISE_SEQUENTIAL
+static int advice_value(VALUE vadvice) {
+        if (NIL_P(vadvice) || vadvice == ID2SYM(rb_intern("normal")))
+                return MDB_ADVISE_NORMAL;
+        if (vadvice == ID2SYM(rb_intern("random")))
+                return MDB_ADVISE_RANDOM;
+        if (vadvice == ID2SYM(rb_intern("sequential")))
+                return MDB_ADVISE_SEQUENTIAL;
+        rb_raise(rb_eArgError, "access pattern must be :normal, :random or :sequential");
+}
+
+/**
+ * @overload advise(pattern)
+ *   Tell the operating system how the data file is accessed, which
+ *   controls how much it reads ahead on page faults.  Unlike the
+ *   +:nordahead+ option this can be changed at any time.  Use +:random+
+ *   for point lookups in a database larger than memory, and sequential
+ *   cursors (see {Database#cursor}) for the scans.
+ *   @param [Symbol] pattern +:normal+, +:random+ or +:sequential+
+ *   @return nil
+ *   @example Point lookups with occasional scans
+ *      env.advise(:random)
+ *      db.each(readahead: true) { |key, value| ... }
+ */
+static VALUE environment_advise(VALUE self, VALUE vadvice) {
+        ENVIRONMENT(self, environment);
+        check(mdb_env_advise(environment->env, advice_value(vadvice)));
+        return Qnil;
+}
+#endif
+
 /**
  * @overload active_txn
  *   @return [Transaction] the current active transaction on this thread in the environment.
@@ -702,8 +1392,241 @@ static VALUE environment_transaction(int argc, VALUE *argv, VALUE self) {
         return with_transaction(self, rb_yield, Qnil, flags);
 }
 
+static void changelog_open(Environment* environment, unsigned int flags) {
+        MDB_txn* txn;
+        int ret;
+
+        // A read-only environment can only tail an existing changelog
+        check(mdb_txn_begin(environment->env, 0, flags & MDB_RDONLY, &txn));
+        ret = mdb_dbi_open(txn, CHANGELOG_NAME, (flags & MDB_RDONLY) ? 0 : MDB_CREATE,
+                           &environment->changelog_dbi);
+        if (ret == MDB_NOTFOUND) {
+                mdb_txn_abort(txn);
+                return;
+        }
+        if (ret) {
+                mdb_txn_abort(txn);
+                check(ret);
+        }
+        check(mdb_txn_commit(txn));
+        environment->changelog = 1;
+}
+
+static void changelog_key(unsigned char* buf, uint64_t txnid, uint64_t seq) {
+        int i;
+        for (i = 7; i >= 0; --i) {
+                buf[i] = txnid & 0xFF;
+                buf[i + 8] = seq & 0xFF;
+                txnid >>= 8;
+                seq >>= 8;
+        }
+}
+
+static uint64_t changelog_read(const unsigned char* buf, int n) {
+        uint64_t v = 0;
+        int i;
+        for (i = 0; i < n; ++i)
+                v = (v << 8) | buf[i];
+        return v;
+}
+
+static int changelog_enabled(VALUE vdb) {
+        DATABASE(vdb, database);
+        ENVIRONMENT(database->env, environment);
+        return environment->changelog;
+}
+
+/*
+ * Append a committed mutation to the changelog inside the same transaction.
+ * Records are keyed by (txnid, seq), so appending is always in key order.
+ */
+static void changelog_append(VALUE vdb, MDB_txn* txn, int op, const MDB_val* key, const MDB_val* value) {
+        if (!changelog_enabled(vdb))
+                return;
+
+        DATABASE(vdb, database);
+        ENVIRONMENT(database->env, environment);
+
+        // The running write transaction will commit as the next txnid
+        MDB_envinfo info;
+        check(mdb_env_info(environment->env, &info));
+        uint64_t txnid = (uint64_t)info.me_last_txnid + 1, seq = 0;
+
+        MDB_cursor* cur;
+        MDB_val k, v;
+        check(mdb_cursor_open(txn, environment->changelog_dbi, &cur));
+        int ret = mdb_cursor_get(cur, &k, &v, MDB_LAST);
+        if (ret == 0 && k.mv_size == CHANGELOG_KEY_SIZE &&
+            changelog_read(k.mv_data, 8) == txnid)
+                seq = changelog_read((const unsigned char*)k.mv_data + 8, 8) + 1;
+        else if (ret && ret != MDB_NOTFOUND) {
+                mdb_cursor_close(cur);
+                check(ret);
+        }
+
+        size_t namelen = NIL_P(database->name) ? 0 : RSTRING_LEN(database->name);
+        size_t keylen = key ? key->mv_size : 0;
+        size_t vallen = value ? value->mv_size : 0;
+
+        unsigned char kbuf[CHANGELOG_KEY_SIZE];
+        changelog_key(kbuf, txnid, seq);
+        k.mv_size = CHANGELOG_KEY_SIZE;
+        k.mv_data = kbuf;
+        v.mv_size = CHANGELOG_HEADER_SIZE + namelen + keylen + vallen;
+        v.mv_data = 0;
+
+        ret = mdb_cursor_put(cur, &k, &v, MDB_APPEND | MDB_RESERVE);
+        if (ret == 0) {
+                unsigned char* p = v.mv_data;
+                p[0] = op;
+                p[1] = (namelen >> 8) & 0xFF;
+                p[2] = namelen & 0xFF;
+                p[3] = (keylen >> 24) & 0xFF;
+                p[4] = (keylen >> 16) & 0xFF;
+                p[5] = (keylen >> 8) & 0xFF;
+                p[6] = keylen & 0xFF;
+                p += CHANGELOG_HEADER_SIZE;
+                if (namelen)
+                        memcpy(p, RSTRING_PTR(database->name), namelen);
+                if (keylen)
+                        memcpy(p + namelen, key->mv_data, keylen);
+                if (vallen)
+                        memcpy(p + namelen + keylen, value->mv_data, vallen);
+        }
+        mdb_cursor_close(cur);
+        check(ret);
+}
+
+typedef struct {
+        MDB_cursor* cur;
+        uint64_t    txnid;
+} ChangelogIter;
+
+static VALUE changelog_each(VALUE arg) {
+        ChangelogIter* it = (ChangelogIter*)arg;
+        unsigned char kbuf[CHANGELOG_KEY_SIZE];
+        MDB_val key, value;
+        MDB_cursor_op op = MDB_SET_RANGE;
+
+        changelog_key(kbuf, it->txnid + 1, 0);
+        key.mv_size = CHANGELOG_KEY_SIZE;
+        key.mv_data = kbuf;
+
+        for (;;) {
+                int ret = mdb_cursor_get(it->cur, &key, &value, op);
+                if (ret == MDB_NOTFOUND)
+                        break;
+                check(ret);
+                op = MDB_NEXT;
+
+                const unsigned char* p = value.mv_data;
+                if (key.mv_size != CHANGELOG_KEY_SIZE || value.mv_size < CHANGELOG_HEADER_SIZE)
+                        rb_raise(cError, "Corrupted changelog record");
+                size_t namelen = changelog_read(p + 1, 2);
+                size_t keylen = changelog_read(p + 3, 4);
+                if (CHANGELOG_HEADER_SIZE + namelen + keylen > value.mv_size)
+                        rb_raise(cError, "Corrupted changelog record");
+                size_t vallen = value.mv_size - CHANGELOG_HEADER_SIZE - namelen - keylen;
+                p += CHANGELOG_HEADER_SIZE;
+
+                VALUE vop;
+                switch (((const unsigned char*)value.mv_data)[0]) {
+                case CHANGE_PUT:    vop = ID2SYM(rb_intern("put")); break;
+                case CHANGE_DELETE: vop = ID2SYM(rb_intern("delete")); break;
+                case CHANGE_CLEAR:  vop = ID2SYM(rb_intern("clear")); break;
+                default:            rb_raise(cError, "Corrupted changelog record");
+                }
+
+                VALUE change = rb_ary_new2(6);
+                rb_ary_push(change, ULL2NUM(changelog_read(key.mv_data, 8)));
+                rb_ary_push(change, ULL2NUM(changelog_read((const unsigned char*)key.mv_data + 8, 8)));
+                rb_ary_push(change, vop);
+                rb_ary_push(change, namelen ? rb_str_new((const char*)p, namelen) : Qnil);
+                rb_ary_push(change, keylen ? rb_str_new((const char*)p + namelen, keylen) : Qnil);
+                rb_ary_push(change, vallen ? rb_str_new((const char*)p + namelen + keylen, vallen) : Qnil);
+                rb_yield(change);
+        }
+
+        return Qnil;
+}
+
+/**
+ * @overload changes_since(txnid)
+ *   Iterate over the mutations committed after the given transaction id.
+ *   The environment must have been opened with +:changelog+.
+ *
+ *   Each change is yielded as an array +[txnid, seq, op, database, key, value]+
+ *   where +op+ is one of +:put+, +:delete+ or +:clear+ and +database+ is the
+ *   name of the modified database (+nil+ for the main database).  +key+ and
+ *   +value+ are +nil+ when the operation does not carry them.
+ *
+ *   @note The block runs inside a read-only transaction.
+ *   @param [Integer] txnid Only changes committed by later transactions are returned.
+ *   @yield [change] The block to be executed for every change.
+ *   @return [Enumerator] in lieu of a block.
+ *   @example Tail the changelog
+ *      last = 0
+ *      env.changes_since(last) do |txnid, seq, op, db, key, value|
+ *        last = txnid
+ *      end
+ */
+static VALUE environment_changes_since(VALUE self, VALUE vtxnid) {
+        RETURN_ENUMERATOR(self, 1, &vtxnid);
+
+        ENVIRONMENT(self, environment);
+        if (!environment->changelog)
+                rb_raise(cError, "Changelog is not enabled");
+        if (!active_txn(self))
+                return call_with_transaction(self, self, "changes_since", 1, &vtxnid, MDB_RDONLY);
+
+        ChangelogIter it;
+        it.txnid = NUM2ULL(vtxnid);
+        check(mdb_cursor_open(need_txn(self), environment->changelog_dbi, &it.cur));
+
+        int exception;
+        rb_protect(changelog_each, (VALUE)&it, &exception);
+        mdb_cursor_close(it.cur);
+        if (exception)
+                rb_jump_tag(exception);
+
+        return Qnil;
+}
+
+/**
+ * @overload truncate_changes(txnid)
+ *   Remove the changelog entries of all transactions up to and including
+ *   the given transaction id, e.g. after every consumer has processed them.
+ *   @param [Integer] txnid The last transaction id to remove.
+ *   @return nil
+ */
+static VALUE environment_truncate_changes(VALUE self, VALUE vtxnid) {
+        ENVIRONMENT(self, environment);
+        if (!environment->changelog)
+                rb_raise(cError, "Changelog is not enabled");
+        if (!active_txn(self))
+                return call_with_transaction(self, self, "truncate_changes", 1, &vtxnid, 0);
+
+        uint64_t txnid = NUM2ULL(vtxnid);
+        MDB_cursor* cur;
+        MDB_val key, value;
+        int ret;
+
+        check(mdb_cursor_open(need_txn(self), environment->changelog_dbi, &cur));
+        while ((ret = mdb_cursor_get(cur, &key, &value, MDB_FIRST)) == 0 &&
+               changelog_read(key.mv_data, 8) <= txnid) {
+                if ((ret = mdb_cursor_del(cur, 0)))
+                        break;
+        }
+        mdb_cursor_close(cur);
+        if (ret != MDB_NOTFOUND)
+                check(ret);
+
+        return Qnil;
+}
+
 static void database_mark(Database* database) {
         rb_gc_mark(database->env);
+        rb_gc_mark(database->name);
 }
 
 #define METHOD database_flags
@@ -768,6 +1691,7 @@ static VALUE environment_database(int argc, VALUE *argv, VALUE self) {
         VALUE vdb = Data_Make_Struct(cDatabase, Database, database_mark, free, database);
         database->dbi = dbi;
         database->env = self;
+        database->name = NIL_P(name) ? Qnil : rb_str_new_frozen(name);
 
         return vdb;
 }
@@ -794,6 +1718,213 @@ static VALUE database_stat(VALUE self) {
         return stat2hash(&stat);
 }
 
+#ifdef MDB_WALK_LEAF
+// Power-of-two class of a size: 0 for 0, else 1 + log2 of the smallest
+// power of two that is not below it
+static int size_class(size_t n) {
+        int c = 0;
+        if (n)
+                for (c = 1; c < REPORT_SIZES - 1 && ((size_t)1 << (c - 1)) < n; ++c)
+                        ;
+        return c;
+}
+
+static VALUE size_histogram(const size_t* counts) {
+        VALUE ret = rb_hash_new();
+        int c;
+        for (c = 0; c < REPORT_SIZES; ++c) {
+                if (counts[c])
+                        rb_hash_aset(ret, SIZET2NUM(c ? (size_t)1 << (c - 1) : 0), SIZET2NUM(counts[c]));
+        }
+        return ret;
+}
+
+static VALUE fill_report(size_t pages, size_t used, const size_t* fill, size_t psize) {
+        VALUE ret = rb_hash_new();
+        VALUE histogram = rb_ary_new();
+        int i;
+        for (i = 0; i < REPORT_FILL; ++i)
+                rb_ary_push(histogram, SIZET2NUM(fill[i]));
+        rb_hash_aset(ret, ID2SYM(rb_intern("pages")), SIZET2NUM(pages));
+        rb_hash_aset(ret, ID2SYM(rb_intern("fill")), DBL2NUM(pages ? (double)used / (pages * psize) : 0));
+        rb_hash_aset(ret, ID2SYM(rb_intern("fill_histogram")), histogram);
+        return ret;
+}
+
+static int page_report_page(const MDB_page_info* page, void* ctx) {
+        PageReport* report = ctx;
+        if (page->mpi_flags & MDB_WALK_OVERFLOW)
+                return 0;
+
+        int fill = page->mpi_used * REPORT_FILL / report->psize;
+        if (fill >= REPORT_FILL)
+                fill = REPORT_FILL - 1;
+
+        if (page->mpi_flags & MDB_WALK_SUBDB) {
+                ++report->subdb_pages;
+                report->subdb_used += page->mpi_used;
+                ++report->subdb_fill[fill];
+                return 0;
+        }
+
+        int depth = page->mpi_depth < REPORT_LEVELS ? page->mpi_depth : REPORT_LEVELS - 1;
+        ++report->level_pages[depth];
+        report->level_used[depth] += page->mpi_used;
+        ++report->level_fill[depth][fill];
+
+        if (page->mpi_flags & MDB_WALK_LEAF) {
+                if (report->leaf_pages && page->mpi_pgno == report->last_leaf + 1)
+                        ++report->sequential_leaves;
+                ++report->leaf_pages;
+                report->last_leaf = page->mpi_pgno;
+        }
+        return 0;
+}
+
+static int page_report_node(const MDB_node_info* node, void* ctx) {
+        PageReport* report = ctx;
+        ++report->key_sizes[size_class(node->mni_ksize)];
+
+        if (node->mni_flags & (MDB_WALK_DUPDATA | MDB_WALK_SUBDB)) {
+                if (node->mni_flags & MDB_WALK_SUBDB)
+                        ++report->dup_subdbs;
+                else
+                        ++report->dup_inline;
+                if (node->mni_dups > report->dup_max)
+                        report->dup_max = node->mni_dups;
+                ++report->dup_counts[size_class(node->mni_dups)];
+                return 0;
+        }
+
+        ++report->value_sizes[size_class(node->mni_dsize)];
+        if (node->mni_flags & MDB_WALK_BIGDATA)
+                report->overflow_pages[size_class(node->mni_dsize)] += node->mni_pages;
+        return 0;
+}
+
+/**
+ * @overload page_report
+ *   Walk the whole B-tree of the database and report how its pages are
+ *   filled and how the keys and values are sized.  This reads every
+ *   page of the database, so it can take a while on large databases.
+ *   Size histograms are hashes from a power of two to the number of
+ *   items whose size is at most that and more than half of it.
+ *   @return [Hash] the report
+ *   * +:psize+ Size of a database page
+ *   * +:levels+ One hash per level of the tree, root first, with the
+ *     number of +:pages+, the mean +:fill+ factor (0.0 to 1.0) and a
+ *     +:fill_histogram+ counting the pages filled 0-10%, 10-20%, ... 90-100%
+ *   * +:leaf_pages+ Number of leaf pages
+ *   * +:sequential_leaves+ Number of leaf pages which directly follow the
+ *     previous leaf in the file, so that a scan reads them sequentially
+ *   * +:key_sizes+ Histogram of key sizes
+ *   * +:value_sizes+ Histogram of value sizes (not including duplicates)
+ *   * +:overflow_pages+ Number of overflow pages by value size class
+ *   * +:dupsort+ For +:dupsort+ databases, a hash with the number of keys
+ *     storing their values +:inline+ on a sub-page or in +:subdbs+,
+ *     the number of +:subdb_pages+ with their +:fill+ and +:fill_histogram+,
+ *     the largest number of values of a key as +:max_values+, and a
+ *     histogram of +:value_counts+
+ *   @example Decide whether to compact
+ *      report = db.page_report
+ *      report[:levels].last[:fill] # => 0.52
+ */
+static VALUE database_page_report(VALUE self) {
+        DATABASE(self, database);
+        if (!active_txn(database->env))
+                return call_with_transaction(database->env,
+                                             self, "page_report", 0, 0, MDB_RDONLY);
+
+        MDB_txn* txn = need_txn(database->env);
+        MDB_stat stat;
+        unsigned int flags;
+        check(mdb_stat(txn, database->dbi, &stat));
+        check(mdb_dbi_flags(txn, database->dbi, &flags));
+
+        PageReport report;
+        memset(&report, 0, sizeof(report));
+        report.psize = stat.ms_psize;
+        check(mdb_walk(txn, database->dbi, page_report_page, page_report_node, &report));
+
+        VALUE ret = rb_hash_new();
+        VALUE levels = rb_ary_new();
+        int i;
+        for (i = 0; i < REPORT_LEVELS && report.level_pages[i]; ++i)
+                rb_ary_push(levels, fill_report(report.level_pages[i], report.level_used[i],
+                                                report.level_fill[i], report.psize));
+
+        rb_hash_aset(ret, ID2SYM(rb_intern("psize")), SIZET2NUM(report.psize));
+        rb_hash_aset(ret, ID2SYM(rb_intern("levels")), levels);
+        rb_hash_aset(ret, ID2SYM(rb_intern("leaf_pages")), SIZET2NUM(report.leaf_pages));
+        rb_hash_aset(ret, ID2SYM(rb_intern("sequential_leaves")), SIZET2NUM(report.sequential_leaves));
+        rb_hash_aset(ret, ID2SYM(rb_intern("key_sizes")), size_histogram(report.key_sizes));
+        rb_hash_aset(ret, ID2SYM(rb_intern("value_sizes")), size_histogram(report.value_sizes));
+        rb_hash_aset(ret, ID2SYM(rb_intern("overflow_pages")), size_histogram(report.overflow_pages));
+
+        if (flags & MDB_DUPSORT) {
+                VALUE dupsort = fill_report(report.subdb_pages, report.subdb_used,
+                                            report.subdb_fill, report.psize);
+                rb_hash_delete(dupsort, ID2SYM(rb_intern("pages")));
+                rb_hash_aset(dupsort, ID2SYM(rb_intern("inline")), SIZET2NUM(report.dup_inline));
+                rb_hash_aset(dupsort, ID2SYM(rb_intern("subdbs")), SIZET2NUM(report.dup_subdbs));
+                rb_hash_aset(dupsort, ID2SYM(rb_intern("subdb_pages")), SIZET2NUM(report.subdb_pages));
+                rb_hash_aset(dupsort, ID2SYM(rb_intern("max_values")), SIZET2NUM(report.dup_max));
+                rb_hash_aset(dupsort, ID2SYM(rb_intern("value_counts")), size_histogram(report.dup_counts));
+                rb_hash_aset(ret, ID2SYM(rb_intern("dupsort")), dupsort);
+        }
+
+        return ret;
+}
+
+static int residency_page(const MDB_page_info* page, void* ctx) {
+        Residency* residency = ctx;
+        int type = (page->mpi_flags & MDB_WALK_BRANCH) ? RESIDENCY_BRANCH :
+                (page->mpi_flags & MDB_WALK_OVERFLOW) ? RESIDENCY_OVERFLOW : RESIDENCY_LEAF;
+        size_t i;
+        residency->pages[type] += page->mpi_pages;
+        for (i = page->mpi_pgno; i < page->mpi_pgno + page->mpi_pages && i < residency->npages; ++i)
+                residency->resident[type] += residency->vec[i];
+        return 0;
+}
+
+/**
+ * @overload residency
+ *   Report how much of the database is in the operating system's page
+ *   cache, by page type.  This walks the whole B-tree, which brings the
+ *   branch and leaf pages it reads into the cache, but the report is
+ *   taken before the walk.  Pages of +:dupsort+ sub-databases are counted
+ *   as branch and leaf pages.
+ *   @return [Hash] +:branch+, +:leaf+ and +:overflow+ hashes with the
+ *       number of +:pages+ and how many of them are +:resident+
+ *   @example Check whether the working set fell out of the cache
+ *      r = db.residency
+ *      r[:leaf][:resident].to_f / r[:leaf][:pages]
+ */
+static VALUE database_residency(VALUE self) {
+        DATABASE(self, database);
+        if (!active_txn(database->env))
+                return call_with_transaction(database->env,
+                                             self, "residency", 0, 0, MDB_RDONLY);
+
+        ENVIRONMENT(database->env, environment);
+        Residency residency;
+        memset(&residency, 0, sizeof(residency));
+        VALUE vec = residency_vector(environment->env, &residency.npages);
+        residency.vec = (const unsigned char*)RSTRING_PTR(vec);
+        check(mdb_walk(need_txn(database->env), database->dbi, residency_page, 0, &residency));
+        RB_GC_GUARD(vec);
+
+        VALUE ret = rb_hash_new();
+        rb_hash_aset(ret, ID2SYM(rb_intern("branch")),
+                     residency_hash(residency.pages[RESIDENCY_BRANCH], residency.resident[RESIDENCY_BRANCH]));
+        rb_hash_aset(ret, ID2SYM(rb_intern("leaf")),
+                     residency_hash(residency.pages[RESIDENCY_LEAF], residency.resident[RESIDENCY_LEAF]));
+        rb_hash_aset(ret, ID2SYM(rb_intern("overflow")),
+                     residency_hash(residency.pages[RESIDENCY_OVERFLOW], residency.resident[RESIDENCY_OVERFLOW]));
+        return ret;
+}
+#endif
+
 /**
  * @overload flags
  *   Return the flags used to open the database.
@@ -867,7 +1998,9 @@ static VALUE database_clear(VALUE self) {
         DATABASE(self, database);
         if (!active_txn(database->env))
                 return call_with_transaction(database->env, self, "clear", 0, 0, 0);
-        check(mdb_drop(need_txn(database->env), database->dbi, 0));
+        MDB_txn* txn = need_txn(database->env);
+        check(mdb_drop(txn, database->dbi, 0));
+        changelog_append(self, txn, CHANGE_CLEAR, 0, 0);
         return Qnil;
 }
 
@@ -890,7 +2023,10 @@ static VALUE database_get(VALUE self, VALUE vkey) {
         key.mv_size = RSTRING_LEN(vkey);
         key.mv_data = RSTRING_PTR(vkey);
 
-        int ret = mdb_get(need_txn(database->env), database->dbi, &key, &value);
+        MDB_txn* txn = need_txn(database->env);
+        uint64_t start = latency_begin(database->env);
+        int ret = mdb_get(txn, database->dbi, &key, &value);
+        latency_end(database->env, LATENCY_get, start);
         if (ret == MDB_NOTFOUND)
                 return Qnil;
         check(ret);
@@ -951,7 +2087,12 @@ static VALUE database_put(int argc, VALUE *argv, VALUE self) {
         value.mv_size = RSTRING_LEN(vval);
         value.mv_data = RSTRING_PTR(vval);
 
-        check(mdb_put(need_txn(database->env), database->dbi, &key, &value, flags));
+        MDB_txn* txn = need_txn(database->env);
+        uint64_t start = latency_begin(database->env);
+        int ret = mdb_put(txn, database->dbi, &key, &value, flags);
+        latency_end(database->env, LATENCY_put, start);
+        check(ret);
+        changelog_append(self, txn, CHANGE_PUT, &key, &value);
         return Qnil;
 }
 
@@ -984,14 +2125,25 @@ static VALUE database_delete(int argc, VALUE *argv, VALUE self) {
         key.mv_size = RSTRING_LEN(vkey);
         key.mv_data = RSTRING_PTR(vkey);
 
+        MDB_txn* txn = need_txn(database->env);
+        uint64_t start;
+        int ret;
         if (NIL_P(vval)) {
-                check(mdb_del(need_txn(database->env), database->dbi, &key, 0));
+                start = latency_begin(database->env);
+                ret = mdb_del(txn, database->dbi, &key, 0);
+                latency_end(database->env, LATENCY_delete, start);
+                check(ret);
+                changelog_append(self, txn, CHANGE_DELETE, &key, 0);
         } else {
                 vval = StringValue(vval);
                 MDB_val value;
                 value.mv_size = RSTRING_LEN(vval);
                 value.mv_data = RSTRING_PTR(vval);
-                check(mdb_del(need_txn(database->env), database->dbi, &key, &value));
+                start = latency_begin(database->env);
+                ret = mdb_del(txn, database->dbi, &key, &value);
+                latency_end(database->env, LATENCY_delete, start);
+                check(ret);
+                changelog_append(self, txn, CHANGE_DELETE, &key, &value);
         }
 
         return Qnil;
@@ -1027,13 +2179,16 @@ static VALUE cursor_close(VALUE self) {
 }
 
 /**
- * @overload cursor
+ * @overload cursor(hint: nil)
  *   Create a cursor to iterate through a database. Uses current
  *   transaction, if any. Otherwise, if called with a block,
  *   creates a new transaction for the scope of the block.
  *   Otherwise, fails.
  *
  *   @see Cursor
+ *   @param [Symbol] hint +:sequential+ to prefetch the next leaf page and
+ *       the pages of large values whenever the cursor reaches a new page,
+ *       for forward scans of data that is not in the page cache.
  *   @yield [cursor] A block to be executed with the cursor.
  *   @yieldparam cursor [Cursor] The cursor to be used to iterate
  *   @example
@@ -1043,17 +2198,33 @@ static VALUE cursor_close(VALUE self) {
  *      puts "#{key}: #{value}"
  *    end
  */
-static VALUE database_cursor(VALUE self) {
+static VALUE database_cursor(int argc, VALUE *argv, VALUE self) {
         DATABASE(self, database);
         if (!active_txn(database->env)) {
                 if (!rb_block_given_p()) {
                         rb_raise(cError, "Must call with block or active transaction.");
                 }
-                return call_with_transaction(database->env, self, "cursor", 0, 0, 0);
+                return call_with_transaction(database->env, self, "cursor", argc, argv, 0);
         }
 
+        VALUE option_hash;
+        rb_scan_args(argc, argv, ":", &option_hash);
+#ifdef MDB_ADVISE_SEQUENTIAL
+        int advice = NIL_P(option_hash) ? MDB_ADVISE_NORMAL :
+                advice_value(rb_hash_aref(option_hash, ID2SYM(rb_intern("hint"))));
+#endif
+
         MDB_cursor* cur;
         check(mdb_cursor_open(need_txn(database->env), database->dbi, &cur));
+#ifdef MDB_ADVISE_SEQUENTIAL
+        if (advice != MDB_ADVISE_NORMAL) {
+                int rc = mdb_cursor_advise(cur, advice);
+                if (rc) {
+                        mdb_cursor_close(cur);
+                        check(rc);
+                }
+        }
+#endif
 
         Cursor* cursor;
         VALUE vcur = Data_Make_Struct(cCursor, Cursor, cursor_mark, cursor_free, cursor);
@@ -1093,6 +2264,19 @@ static VALUE database_env(VALUE self) {
         return database->env;
 }
 
+static VALUE cursor_env(Cursor* cursor) {
+        DATABASE(cursor->db, database);
+        return database->env;
+}
+
+static int cursor_get_timed(Cursor* cursor, MDB_val* key, MDB_val* value, MDB_cursor_op op) {
+        VALUE venv = cursor_env(cursor);
+        uint64_t start = latency_begin(venv);
+        int ret = mdb_cursor_get(cursor->cur, key, value, op);
+        latency_end(venv, LATENCY_cursor_get, start);
+        return ret;
+}
+
 /**
  * @overload first
  *    Position the cursor to the first record in the database, and
@@ -1104,7 +2288,7 @@ static VALUE cursor_first(VALUE self) {
         CURSOR(self, cursor);
         MDB_val key, value;
 
-        check(mdb_cursor_get(cursor->cur, &key, &value, MDB_FIRST));
+        check(cursor_get_timed(cursor, &key, &value, MDB_FIRST));
         return rb_assoc_new(rb_str_new(key.mv_data, key.mv_size), rb_str_new(value.mv_data, value.mv_size));
 }
 
@@ -1119,7 +2303,7 @@ static VALUE cursor_last(VALUE self) {
         CURSOR(self, cursor);
         MDB_val key, value;
 
-        check(mdb_cursor_get(cursor->cur, &key, &value, MDB_LAST));
+        check(cursor_get_timed(cursor, &key, &value, MDB_LAST));
         return rb_assoc_new(rb_str_new(key.mv_data, key.mv_size), rb_str_new(value.mv_data, value.mv_size));
 }
 
@@ -1134,7 +2318,7 @@ static VALUE cursor_prev(VALUE self) {
         CURSOR(self, cursor);
         MDB_val key, value;
 
-        int ret = mdb_cursor_get(cursor->cur, &key, &value, MDB_PREV);
+        int ret = cursor_get_timed(cursor, &key, &value, MDB_PREV);
         if (ret == MDB_NOTFOUND)
                 return Qnil;
         check(ret);
@@ -1160,7 +2344,7 @@ static VALUE cursor_next(int argc, VALUE* argv, VALUE self) {
         if (RTEST(nodup))
           op = MDB_NEXT_NODUP;
 
-        int ret = mdb_cursor_get(cursor->cur, &key, &value, op);
+        int ret = cursor_get_timed(cursor, &key, &value, op);
         if (ret == MDB_NOTFOUND)
                 return Qnil;
         check(ret);
@@ -1181,7 +2365,7 @@ static VALUE cursor_next_range(VALUE self, VALUE upper_bound_key) {
         CURSOR(self, cursor);
         MDB_val key, value, ub_key;
 
-        int ret = mdb_cursor_get(cursor->cur, &key, &value, MDB_NEXT);
+        int ret = cursor_get_timed(cursor, &key, &value, MDB_NEXT);
         if (ret == MDB_NOTFOUND)
                 return Qnil;
         check(ret);
@@ -1225,7 +2409,7 @@ static VALUE cursor_next_range(VALUE self, VALUE upper_bound_key) {
                  value.mv_data = StringValuePtr(vval);
          }
 
-         ret = mdb_cursor_get(cursor->cur, &key, &value, op);
+         ret = cursor_get_timed(cursor, &key, &value, op);
 
          if (!NIL_P(vval) && ret == MDB_NOTFOUND)
                  return Qnil;
@@ -1249,7 +2433,7 @@ static VALUE cursor_set_range(VALUE self, VALUE vkey) {
         key.mv_size = RSTRING_LEN(vkey);
         key.mv_data = StringValuePtr(vkey);
 
-        check(mdb_cursor_get(cursor->cur, &key, &value, MDB_SET_RANGE));
+        check(cursor_get_timed(cursor, &key, &value, MDB_SET_RANGE));
         return rb_assoc_new(rb_str_new(key.mv_data, key.mv_size), rb_str_new(value.mv_data, value.mv_size));
 }
 
@@ -1263,7 +2447,7 @@ static VALUE cursor_get(VALUE self) {
         CURSOR(self, cursor);
 
         MDB_val key, value;
-        int ret = mdb_cursor_get(cursor->cur, &key, &value, MDB_GET_CURRENT);
+        int ret = cursor_get_timed(cursor, &key, &value, MDB_GET_CURRENT);
         if (ret == MDB_NOTFOUND)
                 return Qnil;
         check(ret);
@@ -1326,7 +2510,17 @@ static VALUE cursor_put(int argc, VALUE* argv, VALUE self) {
         value.mv_size = RSTRING_LEN(vval);
         value.mv_data = RSTRING_PTR(vval);
 
-        check(mdb_cursor_put(cursor->cur, &key, &value, flags));
+        uint64_t start = latency_begin(cursor_env(cursor));
+        int ret = mdb_cursor_put(cursor->cur, &key, &value, flags);
+        latency_end(cursor_env(cursor), LATENCY_cursor_put, start);
+        check(ret);
+
+        if (changelog_enabled(cursor->db)) {
+                // With :current the key argument is ignored, so log what was stored
+                if (flags & MDB_CURRENT)
+                        check(mdb_cursor_get(cursor->cur, &key, &value, MDB_GET_CURRENT));
+                changelog_append(cursor->db, mdb_cursor_txn(cursor->cur), CHANGE_PUT, &key, &value);
+        }
         return Qnil;
 }
 
@@ -1354,7 +2548,36 @@ static VALUE cursor_delete(int argc, VALUE *argv, VALUE self) {
         if (!NIL_P(option_hash))
                 rb_hash_foreach(option_hash, cursor_delete_flags, (VALUE)&flags);
 
-        check(mdb_cursor_del(cursor->cur, flags));
+        uint64_t start;
+        int ret;
+        if (!changelog_enabled(cursor->db)) {
+                start = latency_begin(cursor_env(cursor));
+                ret = mdb_cursor_del(cursor->cur, flags);
+                latency_end(cursor_env(cursor), LATENCY_cursor_delete, start);
+                check(ret);
+                return Qnil;
+        }
+
+        MDB_val key, value;
+        check(mdb_cursor_get(cursor->cur, &key, &value, MDB_GET_CURRENT));
+
+        // Copy the pair before the page holding it is modified
+        VALUE vkey = rb_str_new(key.mv_data, key.mv_size);
+        VALUE vval = (flags & MDB_NODUPDATA) ? Qnil : rb_str_new(value.mv_data, value.mv_size);
+
+        start = latency_begin(cursor_env(cursor));
+        ret = mdb_cursor_del(cursor->cur, flags);
+        latency_end(cursor_env(cursor), LATENCY_cursor_delete, start);
+        check(ret);
+
+        key.mv_size = RSTRING_LEN(vkey);
+        key.mv_data = RSTRING_PTR(vkey);
+        if (!NIL_P(vval)) {
+                value.mv_size = RSTRING_LEN(vval);
+                value.mv_data = RSTRING_PTR(vval);
+        }
+        changelog_append(cursor->db, mdb_cursor_txn(cursor->cur), CHANGE_DELETE,
+                         &key, NIL_P(vval) ? 0 : &value);
         return Qnil;
 }
 
@@ -1441,14 +2664,32 @@ void Init_lmdb_ext() {
         rb_define_method(cEnvironment, "close", environment_close, 0);
         rb_define_method(cEnvironment, "stat", environment_stat, 0);
         rb_define_method(cEnvironment, "info", environment_info, 0);
+        rb_define_method(cEnvironment, "latency_report", environment_latency_report, -1);
+#ifdef MDB_WALK_LEAF
+        rb_define_method(cEnvironment, "residency", environment_residency, 0);
+#endif
+#ifdef MDB_METRICS_RESET
+        rb_define_method(cEnvironment, "metrics", environment_metrics, -1);
+#endif
         rb_define_method(cEnvironment, "copy", environment_copy, 1);
         rb_define_method(cEnvironment, "sync", environment_sync, -1);
         rb_define_method(cEnvironment, "mapsize=", environment_set_mapsize, 1);
         rb_define_method(cEnvironment, "set_flags", environment_set_flags, -1);
         rb_define_method(cEnvironment, "clear_flags", environment_clear_flags, -1);
+#ifdef MDB_ADVISE_SEQUENTIAL
+        rb_define_method(cEnvironment, "advise", environment_advise, 1);
+#endif
         rb_define_method(cEnvironment, "flags", environment_flags, 0);
         rb_define_method(cEnvironment, "path", environment_path, 0);
         rb_define_method(cEnvironment, "transaction", environment_transaction, -1);
+#ifdef MDB_WAIT_FOREVER
+        rb_define_method(cEnvironment, "wait_for_commit", environment_wait_for_commit, -1);
+#endif
+#ifdef MDB_WARM_LEAVES
+        rb_define_method(cEnvironment, "warm", environment_warm, -1);
+#endif
+        rb_define_method(cEnvironment, "changes_since", environment_changes_since, 1);
+        rb_define_method(cEnvironment, "truncate_changes", environment_truncate_changes, 1);
 
         /**
          * Document-class: LMDB::Database
@@ -1478,6 +2719,10 @@ void Init_lmdb_ext() {
         cDatabase = rb_define_class_under(mLMDB, "Database", rb_cObject);
         rb_undef_method(rb_singleton_class(cDatabase), "new");
         rb_define_method(cDatabase, "stat", database_stat, 0);
+#ifdef MDB_WALK_LEAF
+        rb_define_method(cDatabase, "page_report", database_page_report, 0);
+        rb_define_method(cDatabase, "residency", database_residency, 0);
+#endif
         rb_define_method(cDatabase, "flags", database_get_flags, 0);
         rb_define_method(cDatabase, "dupsort?", database_is_dupsort, 0);
         rb_define_method(cDatabase, "dupfixed?", database_is_dupfixed, 0);
@@ -1486,7 +2731,7 @@ void Init_lmdb_ext() {
         rb_define_method(cDatabase, "get", database_get, 1);
         rb_define_method(cDatabase, "put", database_put, -1);
         rb_define_method(cDatabase, "delete", database_delete, -1);
-        rb_define_method(cDatabase, "cursor", database_cursor, 0);
+        rb_define_method(cDatabase, "cursor", database_cursor, -1);
         rb_define_method(cDatabase, "env", database_env, 0);
 
         /**
@@ -1551,6 +2796,9 @@ void Init_lmdb_ext() {
         rb_define_method(cTransaction, "commit", transaction_commit, 0);
         rb_define_method(cTransaction, "abort", transaction_abort, 0);
         rb_define_method(cTransaction, "env", transaction_env, 0);
+#ifdef MDB_COMMIT_LATENCY
+        rb_define_method(cTransaction, "commit_stats", transaction_commit_stats, 0);
+#endif
 
         /**
          * Document-class: LMDB::Cursor
@@ -24,6 +24,15 @@
 #  endif
 #endif
 
+// Ruby 1.8 compatibility
+#ifndef NUM2SIZET
+#  if defined(HAVE_LONG_LONG) && SIZEOF_SIZE_T > SIZEOF_LONG
+#   define NUM2SIZET(x) ((size_t)NUM2ULL(x))
+#  else
+#   define NUM2SIZET(x) NUM2ULONG(x)
+#  endif
+#endif
+
 // Ruby 2.0 compatibility
 #ifndef RARRAY_AREF
 #  define RARRAY_AREF(ary,n) (RARRAY_PTR(ary)[n])
@@ -53,16 +62,45 @@ typedef struct {
         VALUE    thread;
         VALUE    cursors;
         MDB_txn* txn;
+        int      flags;
+#ifdef MDB_COMMIT_LATENCY
+        int      committed;
+        MDB_commit_latency latency;
+#endif
 } Transaction;
 
+// Latency histogram: 2^HISTOGRAM_SUB_BITS linear buckets per power of two
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS)
+
+typedef struct {
+        uint64_t count;
+        uint64_t sum;
+        uint64_t min;
+        uint64_t max;
+        uint64_t buckets[HISTOGRAM_BUCKETS];
+} Histogram;
+
+enum {
+#define OP(name) LATENCY_##name,
+#include "latency_ops.h"
+#undef OP
+        LATENCY_OPS
+};
+
 typedef struct {
-        MDB_env* env;
-        VALUE    thread_txn_hash;
-        VALUE    txn_thread_hash;
+        MDB_env*   env;
+        VALUE      thread_txn_hash;
+        VALUE      txn_thread_hash;
+        int        changelog;
+        MDB_dbi    changelog_dbi;
+        Histogram* latency;
+        VALUE      warmers;
 } Environment;
 
 typedef struct {
         VALUE   env;
+        VALUE   name;
         MDB_dbi dbi;
 } Database;
 
@@ -83,9 +121,71 @@ typedef struct {
         int    flags;
         int    maxreaders;
         int    maxdbs;
+        int    maxdirty;
+        int    writers;
         size_t mapsize;
+        int    changelog;
+        int    latency;
 } EnvironmentOptions;
 
+// Name of the internal database holding the changelog
+#define CHANGELOG_NAME "__changelog"
+
+// Changelog key: big-endian txnid followed by big-endian sequence number
+#define CHANGELOG_KEY_SIZE 16
+
+// Changelog record header: op, database name length, key length
+#define CHANGELOG_HEADER_SIZE 7
+
+enum {
+        CHANGE_PUT = 1,
+        CHANGE_DELETE,
+        CHANGE_CLEAR
+};
+
+// Page report: power-of-two size classes, 10% fill buckets, tree levels
+#define REPORT_SIZES 40
+#define REPORT_FILL 10
+#define REPORT_LEVELS 32
+
+typedef struct {
+        size_t psize;
+        size_t level_pages[REPORT_LEVELS];
+        size_t level_used[REPORT_LEVELS];
+        size_t level_fill[REPORT_LEVELS][REPORT_FILL];
+        size_t leaf_pages;
+        size_t sequential_leaves;
+        size_t last_leaf;
+        size_t key_sizes[REPORT_SIZES];
+        size_t value_sizes[REPORT_SIZES];
+        size_t overflow_pages[REPORT_SIZES];
+        size_t dup_inline;
+        size_t dup_subdbs;
+        size_t dup_max;
+        size_t dup_counts[REPORT_SIZES];
+        size_t subdb_pages;
+        size_t subdb_used;
+        size_t subdb_fill[REPORT_FILL];
+} PageReport;
+
+// Pages checked by each mdb_env_mincore call of Environment#residency
+#define RESIDENCY_CHUNK 16384
+
+// Page types of a residency report
+enum {
+        RESIDENCY_BRANCH,
+        RESIDENCY_LEAF,
+        RESIDENCY_OVERFLOW,
+        RESIDENCY_TYPES
+};
+
+typedef struct {
+        const unsigned char* vec;
+        size_t npages;
+        size_t pages[RESIDENCY_TYPES];
+        size_t resident[RESIDENCY_TYPES];
+} Residency;
+
 typedef struct {
         MDB_env *env;
         MDB_txn *parent;
@@ -93,8 +193,30 @@ typedef struct {
         MDB_txn **htxn;
         int result;
         int stop;
+        int timed;
+        uint64_t elapsed;
 } TxnArgs;
 
+typedef struct {
+        MDB_env *env;
+        MDB_txn *txn;
+        const MDB_dbi *dbis;
+        int ndbs;
+        MDB_val *from;
+        MDB_val *to;
+        unsigned int flags;
+        size_t pages;
+        int result;
+} WarmArgs;
+
+typedef struct {
+        MDB_env *env;
+        size_t txnid;
+        unsigned int msec;
+        size_t last;
+        int result;
+} WaitArgs;
+
 static VALUE cEnvironment, cDatabase, cTransaction, cCursor, cError;
 
 #define ERROR(name) static VALUE cError_##name;
@@ -104,16 +226,27 @@ static VALUE cEnvironment, cDatabase, cTransaction, cCursor, cError;
 // BEGIN PROTOTYPES
 void Init_lmdb_ext();
 static MDB_txn* active_txn(VALUE self);
+#ifdef MDB_ADVISE_SEQUENTIAL
+static int advice_value(VALUE vadvice);
+#endif
 static VALUE call_with_transaction(VALUE venv, VALUE self, const char* name, int argc, const VALUE* argv, int flags);
 static VALUE call_with_transaction_helper(VALUE arg);
+static void changelog_append(VALUE vdb, MDB_txn* txn, int op, const MDB_val* key, const MDB_val* value);
+static VALUE changelog_each(VALUE arg);
+static int changelog_enabled(VALUE vdb);
+static void changelog_key(unsigned char* buf, uint64_t txnid, uint64_t seq);
+static void changelog_open(Environment* environment, unsigned int flags);
+static uint64_t changelog_read(const unsigned char* buf, int n);
 static void check(int code);
 static void cursor_check(Cursor* cursor);
 static VALUE cursor_close(VALUE self);
 static VALUE cursor_count(VALUE self);
 static VALUE cursor_delete(int argc, VALUE *argv, VALUE self);
+static VALUE cursor_env(Cursor* cursor);
 static VALUE cursor_first(VALUE self);
 static void cursor_free(Cursor* cursor);
 static VALUE cursor_get(VALUE self);
+static int cursor_get_timed(Cursor* cursor, MDB_val* key, MDB_val* value, MDB_cursor_op op);
 static VALUE cursor_last(VALUE self);
 static void cursor_mark(Cursor* cursor);
 static VALUE cursor_next(int argc, VALUE* argv, VALUE self);
@@ -122,17 +255,27 @@ static VALUE cursor_put(int argc, VALUE* argv, VALUE self);
 static VALUE cursor_set(int argc, VALUE* argv, VALUE self);
 static VALUE cursor_set_range(VALUE self, VALUE vkey);
 static VALUE database_clear(VALUE self);
-static VALUE database_cursor(VALUE self);
+static VALUE database_cursor(int argc, VALUE *argv, VALUE self);
 static VALUE database_delete(int argc, VALUE *argv, VALUE self);
 static VALUE database_drop(VALUE self);
 static VALUE database_get(VALUE self, VALUE vkey);
 static void database_mark(Database* database);
 static VALUE database_put(int argc, VALUE *argv, VALUE self);
+#ifdef MDB_WALK_LEAF
+static VALUE database_residency(VALUE self);
+#endif
 static VALUE database_stat(VALUE self);
 static VALUE database_get_flags(VALUE self);
 static VALUE database_is_dupsort(VALUE self);
 static VALUE database_is_dupfixed(VALUE self);
+#ifdef MDB_WALK_LEAF
+static VALUE database_page_report(VALUE self);
+#endif
 static VALUE environment_active_txn(VALUE self);
+#ifdef MDB_ADVISE_SEQUENTIAL
+static VALUE environment_advise(VALUE self, VALUE vadvice);
+#endif
+static VALUE environment_changes_since(VALUE self, VALUE vtxnid);
 static VALUE environment_change_flags(int argc, VALUE* argv, VALUE self, int set);
 static void environment_check(Environment* environment);
 static VALUE environment_clear_flags(int argc, VALUE* argv, VALUE self);
@@ -142,22 +285,61 @@ static VALUE environment_database(int argc, VALUE *argv, VALUE self);
 static VALUE environment_flags(VALUE self);
 static void environment_free(Environment *environment);
 static VALUE environment_info(VALUE self);
+static VALUE environment_latency_report(int argc, VALUE *argv, VALUE self);
+#ifdef MDB_METRICS_RESET
+static VALUE environment_metrics(int argc, VALUE *argv, VALUE self);
+#endif
 static void environment_mark(Environment* environment);
 static VALUE environment_new(int argc, VALUE *argv, VALUE klass);
 static int environment_options(VALUE key, VALUE value, EnvironmentOptions* options);
 static VALUE environment_path(VALUE self);
+#ifdef MDB_WALK_LEAF
+static VALUE environment_residency(VALUE self);
+#endif
 static void environment_set_active_txn(VALUE self, VALUE thread, VALUE txn);
 static VALUE environment_set_flags(int argc, VALUE* argv, VALUE self);
 static VALUE environment_stat(VALUE self);
 static VALUE environment_sync(int argc, VALUE *argv, VALUE self);
 static VALUE environment_transaction(int argc, VALUE *argv, VALUE self);
+#ifdef MDB_WAIT_FOREVER
+static VALUE environment_wait_for_commit(int argc, VALUE *argv, VALUE self);
+#endif
+#ifdef MDB_WARM_LEAVES
+static VALUE environment_warm(int argc, VALUE *argv, VALUE self);
+#endif
+static VALUE environment_truncate_changes(VALUE self, VALUE vtxnid);
+static int histogram_bucket(uint64_t v);
+static void histogram_record(Histogram* histogram, uint64_t v);
+static VALUE histogram_report(const Histogram* histogram);
+static uint64_t histogram_value(int bucket);
+static uint64_t latency_begin(VALUE venv);
+static uint64_t latency_clock(void);
+static void latency_end(VALUE venv, int op, uint64_t start);
 static MDB_txn* need_txn(VALUE self);
+#ifdef MDB_WALK_LEAF
+static VALUE fill_report(size_t pages, size_t used, const size_t* fill, size_t psize);
+static int page_report_node(const MDB_node_info* node, void* ctx);
+static int page_report_page(const MDB_page_info* page, void* ctx);
+static int size_class(size_t n);
+static size_t residency_count(MDB_env* env, size_t* npages);
+static VALUE residency_hash(size_t pages, size_t resident);
+static int residency_page(const MDB_page_info* page, void* ctx);
+static VALUE residency_vector(MDB_env* env, size_t* npages);
+static VALUE size_histogram(const size_t* counts);
+#endif
 static VALUE stat2hash(const MDB_stat* stat);
 static VALUE transaction_abort(VALUE self);
 static VALUE transaction_commit(VALUE self);
+#ifdef MDB_COMMIT_LATENCY
+static VALUE transaction_commit_stats(VALUE self);
+#endif
 static void transaction_finish(VALUE self, int commit);
 static void transaction_free(Transaction* transaction);
 static void transaction_mark(Transaction* transaction);
+#ifdef MDB_WARM_LEAVES
+static VALUE warm(VALUE self, VALUE option_hash);
+static VALUE warm_thread(void* arg);
+#endif
 static VALUE with_transaction(VALUE venv, VALUE(*fn)(VALUE), VALUE arg, int flags);
 // END PROTOTYPES
 
@@ -0,0 +1,14 @@
+#ifndef _LMDB_EXT_PROBES_H
+#define _LMDB_EXT_PROBES_H
+
+// USDT probes of the lmdb_ext provider, no-ops without <sys/sdt.h>:
+//   gvl__release(func)    before the GVL is released to run func
+//   gvl__reacquire(func)  after the GVL has been taken back
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define PROBE1(name, a) DTRACE_PROBE1(lmdb_ext, name, a)
+#else
+#define PROBE1(name, a)
+#endif
+
+#endif
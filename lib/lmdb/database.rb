@@ -3,6 +3,8 @@ module LMDB
     include Enumerable
 
     # Iterate through the records in a database
+    # @param [Boolean] readahead Prefetch the pages ahead of the scan,
+    #      see {#cursor}
     # @yield [i] Gives a record [key, value] to the block
     # @yieldparam [Array] i The key, value pair for each record
     # @example
@@ -10,9 +12,10 @@ module LMDB
     #      key, value = record
     #      puts "at #{key}: #{value}"
     #    end
-    def each
+    def each(readahead: false)
+      return enum_for(:each, readahead: readahead) unless block_given?
       env.transaction true do
-        cursor do |c|
+        cursor(hint: readahead ? :sequential : nil) do |c|
           while i = c.next
             yield(i)
           end
@@ -19,6 +19,18 @@ module LMDB::SpecHelper
   def env
     @env ||= LMDB::Environment.new :path => path
   end
+
+  # Number of Ruby objects allocated by the block. Measured twice, as
+  # the first call of a call site allocates its inline cache.
+  def allocations
+    count = nil
+    2.times do
+      before = GC.stat(:total_allocated_objects)
+      yield
+      count = GC.stat(:total_allocated_objects) - before
+    end
+    count
+  end
 end
 
 RSpec.configure do |c|
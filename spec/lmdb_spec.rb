@@ -70,6 +70,363 @@ describe LMDB do
       info[:numreaders].should be_instance_of(Integer)
     end
 
+    it 'should return metrics' do
+      env.metrics(true)
+      env.transaction do
+        1000.times { |i| db["key#{i}"] = 'x' * 100 }
+      end
+      metrics = env.metrics
+      metrics[:splits].should > 0
+      metrics[:alloc_extend].should > 0
+      metrics[:flush_pages].should >= metrics[:alloc_extend]
+      metrics[:flush_bytes].should == metrics[:flush_pages] * env.stat[:psize]
+      metrics[:flush_writes].should > 0
+      env.metrics(true)[:splits].should == metrics[:splits]
+      env.metrics[:splits].should == 0
+    end
+
+    it 'should count flushed bytes with writemap' do
+      LMDB.new(mkpath('wmetrics'), :mapsize => 1 << 26, :writemap => true) do |wenv|
+        wdb = wenv.database
+        wenv.metrics(true)
+        wenv.transaction { 200.times { |i| wdb["w#{i}"] = 'x' * 5000 } }
+        metrics = wenv.metrics
+        metrics[:flush_pages].should >= 400
+        metrics[:flush_bytes].should == metrics[:flush_pages] * wenv.stat[:psize]
+      end
+    end
+
+    it 'should scan the reader table once per transaction' do
+      LMDB.new(mkpath('oldest'), :mapsize => 1 << 26) do |oenv|
+        odb = oenv.database
+        oenv.transaction { 500.times { |i| odb["r#{i}"] = 'x' * 5000 } }
+        oenv.transaction { 500.times { |i| odb.delete("r#{i}") } }
+        oenv.metrics(true)
+        oenv.transaction { 50.times { |i| odb["s#{i}"] = 'y' * 5000 } }
+        oenv.metrics[:reader_scans].should == 1
+      end
+    end
+
+    it 'should reuse fragmented free pages for large values' do
+      LMDB.new(mkpath('extents'), :mapsize => 1 << 26) do |xenv|
+        xdb = xenv.database
+        xenv.transaction do
+          1000.times { |i| xdb['big%04d' % i] = 'x' * 12000 }
+        end
+        xenv.transaction do
+          1000.times { |i| xdb.delete('big%04d' % i) if i.odd? || (800...900).include?(i) }
+        end
+        # The freed pages are reusable once no snapshot can see them
+        xenv.transaction { xdb['pad'] = 'x' }
+        xenv.metrics(true)
+        xenv.transaction do
+          10.times { |i| xdb['large%d' % i] = i.to_s * 20000 }
+        end
+        metrics = xenv.metrics
+        metrics[:alloc_freelist].should >= 50
+        metrics[:extent_hits].should > 0
+        metrics[:extent_rebuilds].should > 0
+        10.times { |i| xdb['large%d' % i].should == i.to_s * 20000 }
+      end
+    end
+
+    it 'should find dirty pages in large transactions' do
+      LMDB.new(mkpath('dirty'), :mapsize => 1 << 26) do |denv|
+        ddb = denv.database
+        denv.metrics(true)
+        denv.transaction do
+          2000.times { |i| ddb['d%04d' % i] = i.to_s * 1000 }
+          denv.transaction do |child|
+            500.times { |i| ddb['d%04d' % (i * 3)] = 'child' * 100 }
+            child.abort
+          end
+          denv.transaction do
+            500.times { |i| ddb['d%04d' % (i * 4)] = 'child' * 100 }
+          end
+          ddb['d0003'].should == '3' * 1000
+          ddb['d0004'].should == 'child' * 100
+          ddb['d1999'].should == '1999' * 1000
+        end
+        denv.metrics[:dirty_hash_builds].should > 0
+        2000.times { |i| ddb['d%04d' % i].should == (i % 4 == 0 ? 'child' * 100 : i.to_s * 1000) }
+      end
+    end
+
+    it 'should spill dirty pages past maxdirty' do
+      LMDB.new(mkpath('maxdirty'), :mapsize => 1 << 26, :maxdirty => 2048) do |senv|
+        sdb = senv.database
+        senv.info[:maxdirty].should == 2048
+        senv.metrics(true)
+        senv.transaction do
+          3000.times { |i| sdb['s%04d' % i] = i.to_s * 1250 }
+          senv.transaction do
+            300.times { |i| sdb['s%04d' % (i * 3)] = 'child' * 1000 }
+          end
+          sdb['s0003'].should == 'child' * 1000
+          sdb['s0004'].should == '4' * 1250
+        end
+        senv.metrics[:spills].should > 0
+        3000.times { |i| sdb['s%04d' % i].should == (i % 3 == 0 && i < 900 ? 'child' * 1000 : i.to_s * 1250) }
+      end
+
+      LMDB.new(mkpath('growdirty'), :mapsize => 1 << 26) do |genv|
+        gdb = genv.database
+        genv.info[:maxdirty].should == 131071
+        genv.metrics(true)
+        genv.transaction { 3000.times { |i| gdb['g%04d' % i] = i.to_s * 1250 } }
+        genv.metrics[:spills].should == 0
+      end
+    end
+
+    it 'should allocate dirty pages from an arena' do
+      LMDB.new(mkpath('arena'), :mapsize => 1 << 28) do |aenv|
+        adb = aenv.database
+        aenv.metrics(true)
+        aenv.transaction { 10000.times { |i| adb['a%05d' % i] = i.to_s * 800 } }
+        chunks = aenv.metrics(true)[:arena_chunks]
+        chunks.should > 4
+        aenv.transaction { 10000.times { |i| adb['a%05d' % i] = i.to_s * 800 } }
+        aenv.metrics[:arena_chunks].should < chunks
+        10000.times { |i| adb['a%05d' % i].should == i.to_s * 800 }
+      end
+    end
+
+    it 'should free overflow pages released within a transaction' do
+      LMDB.new(mkpath('arenafree'), :mapsize => 1 << 28) do |aenv|
+        adb = aenv.database
+        aenv.metrics(true)
+        aenv.transaction do
+          400.times do
+            adb['big'] = 'x' * 200_000
+            adb.delete('big')
+          end
+        end
+        aenv.metrics[:arena_chunks].should < 3
+      end
+    end
+
+    it 'should sync once per commit and fall back from a torn one' do
+      path = mkpath('single')
+      LMDB.new(path, :mapsize => 1 << 26, :singlesync => true) do |senv|
+        sdb = senv.database
+        senv.flags.should include(:singlesync)
+        senv.metrics(true)
+        20.times { |i| sdb["s#{i}"] = i.to_s }
+        senv.metrics[:single_syncs].should == 20
+        @txnid, last = senv.info[:last_txnid], senv.info[:last_pgno]
+        sdb['big'] = 'z' * 100_000
+        senv.info[:last_pgno].should > last + 20
+        @psize, @last = senv.stat[:psize], senv.info[:last_pgno]
+      end
+      # Lose part of the large value, as if the crash came before it was synced
+      File.open(File.join(path, 'data.mdb'), 'r+b') { |f| f.pwrite('torn', @last * @psize + 100) }
+      2.times do
+        LMDB.new(path, :mapsize => 1 << 26, :singlesync => true) do |senv|
+          sdb = senv.database
+          senv.info[:last_txnid].should == @txnid
+          sdb['big'].should be_nil
+          sdb['s19'].should == '19'
+        end
+      end
+      LMDB.new(path, :mapsize => 1 << 26, :singlesync => true) do |senv|
+        senv.database['big'] = 'y'
+        senv.info[:last_txnid].should == @txnid + 1
+      end
+      LMDB.new(path, :mapsize => 1 << 26) { |senv| senv.database['big'].should == 'y' }
+    end
+
+    it 'should fall back from a torn commit opened read-only first' do
+      path = mkpath('singlero')
+      LMDB.new(path, :mapsize => 1 << 26, :singlesync => true) do |senv|
+        sdb = senv.database
+        sdb['small'] = 'x'
+        @txnid = senv.info[:last_txnid]
+        sdb['big'] = 'z' * 100_000
+        @psize, @last = senv.stat[:psize], senv.info[:last_pgno]
+      end
+      File.open(File.join(path, 'data.mdb'), 'r+b') { |f| f.pwrite('torn', @last * @psize + 100) }
+      # The read-only process opens first and only passes over the torn meta
+      opened_r, opened_w = IO.pipe
+      done_r, done_w = IO.pipe
+      pid = fork do
+        opened_r.close
+        done_w.close
+        LMDB.new(path, :mapsize => 1 << 26, :rdonly => true) do |renv|
+          opened_w.puts renv.info[:last_txnid]
+          opened_w.close
+          done_r.read
+        end
+        exit!(0)
+      end
+      opened_w.close
+      done_r.close
+      begin
+        opened_r.gets.to_i.should == @txnid
+        LMDB.new(path, :mapsize => 1 << 26, :singlesync => true) do |senv|
+          sdb = senv.database
+          senv.info[:last_txnid].should == @txnid
+          sdb['big'].should be_nil
+          sdb['small'].should == 'x'
+        end
+      ensure
+        done_w.close
+        Process.wait(pid)
+      end
+    end
+
+    it 'should flush pages through io_uring' do
+      path = mkpath('uring')
+      LMDB.new(path, :mapsize => 1 << 28, :iouring => true) do |uenv|
+        udb = uenv.database
+        uenv.flags.should include(:iouring)
+        uenv.metrics(true)
+        uenv.transaction { 5000.times { |i| udb['u%04d' % i] = i.to_s * 800 } }
+        # Where io_uring is not available the pages are written as usual
+        skip 'io_uring is not available' if uenv.metrics[:uring_flushes] == 0
+        10.times { |i| udb["small#{i}"] = i.to_s }
+        uenv.metrics[:uring_flushes].should == 11
+      end
+      LMDB.new(path, :mapsize => 1 << 28) do |uenv|
+        udb = uenv.database
+        5000.times { |i| udb['u%04d' % i].should == i.to_s * 800 }
+        udb['small9'].should == '9'
+      end
+    end
+
+    it 'should write large commits from several threads' do
+      path = mkpath('writers')
+      LMDB.new(path, :mapsize => 1 << 28, :writers => 4) do |wenv|
+        wdb = wenv.database
+        wenv.info[:writers].should == 4
+        wenv.metrics(true)
+        wenv.transaction { 9000.times { |i| wdb['w%04d' % i] = i.to_s * 800 } }
+        10.times { |i| wdb["small#{i}"] = i.to_s }
+        # Writer threads are built where pwritev is available
+        if RUBY_PLATFORM =~ /linux|bsd/
+          wenv.metrics[:writer_flushes].should == 1
+        else
+          wenv.metrics[:writer_flushes].should == 0
+        end
+      end
+      LMDB.new(path, :mapsize => 1 << 28) do |wenv|
+        wdb = wenv.database
+        wenv.info[:writers].should == 1
+        9000.times { |i| wdb['w%04d' % i].should == i.to_s * 800 }
+        wdb['small9'].should == '9'
+      end
+    end
+
+    it 'should save freed pages as ranges' do
+      LMDB.new(mkpath('ranges'), :mapsize => 1 << 26, :freeranges => true) do |renv|
+        rdb = renv.database
+        renv.flags.should include(:freeranges)
+        renv.transaction { 2000.times { |i| rdb['k%04d' % i] = 'x' * 5000 } }
+        renv.metrics(true)
+        rdb.clear
+        metrics = renv.metrics(true)
+        metrics[:freelist_pages].should >= 4000
+        metrics[:flush_pages].should < 5
+        last = renv.info[:last_pgno]
+        renv.transaction { rdb['pad'] = 'x' }
+        renv.transaction { 2000.times { |i| rdb['k%04d' % i] = 'y' * 5000 } }
+        renv.info[:last_pgno].should < last + 100
+        rdb['k1999'].should == 'y' * 5000
+      end
+    end
+
+    it 'should mark the file once it holds free ranges' do
+      path = mkpath('rangesver')
+      LMDB.new(path, :mapsize => 1 << 26) do |renv|
+        renv.database['a'] = 'b'
+        @psize = renv.stat[:psize]
+      end
+      # The data version follows the magic after the page header of both metas
+      versions = lambda do
+        File.open(File.join(path, 'data.mdb'), 'rb') do |f|
+          [0, @psize].map { |off| f.pread(4, off + 20).unpack1('L') }
+        end
+      end
+      versions.call.should == [1, 1]
+      LMDB.new(path, :mapsize => 1 << 26, :freeranges => true) do |renv|
+        rdb = renv.database
+        renv.transaction { 2000.times { |i| rdb['k%04d' % i] = 'x' * 5000 } }
+        rdb.clear
+      end
+      versions.call.max.should == 2
+      LMDB.new(path, :mapsize => 1 << 26) do |renv|
+        2.times { |i| renv.database['pad'] = i.to_s }
+      end
+      versions.call.should == [2, 2]
+    end
+
+    it 'should count the pages of reclaimed ranges' do
+      LMDB.new(mkpath('ranges2'), :mapsize => 1 << 27, :freeranges => true) do |renv|
+        rdb = renv.database
+        renv.transaction { 1100.times { |i| rdb['k%04d' % i] = 'x' * 40000 } }
+        renv.metrics(true)
+        # Every other value frees a run of its own, more than one record holds
+        renv.transaction { 550.times { |i| rdb.delete('k%04d' % (2 * i)) } }
+        freed = renv.metrics(true)[:freelist_pages]
+        renv.transaction { rdb['pad'] = 'x' }
+        renv.metrics(true)
+        # Takes the freed pages and saves them back as ranges, but for the
+        # few it uses in place of the pages it frees
+        renv.transaction { rdb['pad'] = 'xx' }
+        metrics = renv.metrics(true)
+        metrics[:freelist_records].should > 2
+        metrics[:freelist_pages].should be_within(3).of(freed)
+      end
+    end
+
+    it 'should report latencies' do
+      LMDB.new(mkpath('latency'), :latency => true) do |lenv|
+        ldb = lenv.database
+        100.times { |i| ldb["key#{i}"] = 'value' }
+        ldb['key1'].should == 'value'
+        ldb.cursor { |c| c.first; c.next }
+        report = lenv.latency_report(true)
+        report.keys.sort.should == [:begin, :commit, :cursor_get, :get, :put]
+        report[:put][:count].should == 100
+        report[:cursor_get][:count].should == 2
+        put = report[:put]
+        put[:min].should <= put[:p50]
+        put[:p50].should <= put[:p99]
+        put[:p999].should <= put[:max]
+        lenv.latency_report.should == {}
+      end
+      proc { env.latency_report }.should raise_error(LMDB::Error)
+    end
+
+    it 'should warm databases' do
+      env.transaction do
+        2000.times { |i| db['%05d' % i] = 'x' * 100 }
+        db['big'] = 'x' * 10000
+      end
+      stat = db.stat
+      env.warm.should == stat[:branch_pages]
+      env.warm(db: db, levels: :leaves).should == stat[:branch_pages] + stat[:leaf_pages]
+      env.warm(db: [db], levels: :all, touch: true).should ==
+        stat[:branch_pages] + stat[:leaf_pages] + stat[:overflow_pages]
+      env.warm(db: db, levels: :leaves, range: '00100'..'00200').should < stat[:leaf_pages]
+      env.warm(db: db, background: true).value.should == stat[:branch_pages]
+      env.transaction(true) do
+        env.warm(db: db).should == stat[:branch_pages]
+        db['00001'].should == 'x' * 100
+      end
+
+      LMDB.new(mkpath('warmtxn'), :maxreaders => 1) do |wenv|
+        wenv.database['a'] = 'b'
+        wenv.transaction(true) do
+          wenv.warm(levels: :leaves).should == 1
+        end
+      end
+      proc { env.warm(levels: :roots) }.should raise_error(ArgumentError)
+
+      LMDB.new(mkpath('populate'), :mappopulate => true) do |penv|
+        penv.flags.should include(:mappopulate)
+      end
+    end
+
     it 'should set mapsize' do
       size_before = env.info[:mapsize]
       env.mapsize = size_before * 2
@@ -89,6 +446,85 @@ describe LMDB do
       subject.sync(true).should be_nil
     end
 
+    describe 'changelog' do
+      let(:env) { LMDB.new(path, :changelog => true) }
+
+      it 'should record committed mutations' do
+        other = env.transaction { env.database('other', :create => true) }
+        db['a'] = '1'
+        env.transaction do
+          db['b'] = '2'
+          other['c'] = '3'
+          db.delete('a')
+        end
+        env.transaction do |txn|
+          db['d'] = '4'
+          txn.abort
+        end
+        other.clear
+
+        changes = env.changes_since(0).to_a
+        changes.map { |c| c[2..-1] }.should == [[:put, nil, 'a', '1'],
+                                               [:put, nil, 'b', '2'],
+                                               [:put, 'other', 'c', '3'],
+                                               [:delete, nil, 'a', nil],
+                                               [:clear, 'other', nil, nil]]
+        changes[1][0].should == changes[3][0]
+        changes.map { |c| c[1] }.should == [0, 0, 1, 2, 0]
+        env.changes_since(changes[1][0]).to_a.should == changes[-1..-1]
+      end
+
+      it 'should record cursor mutations' do
+        other = env.transaction { env.database('other', :create => true) }
+        other['a'] = '1'
+        other.cursor do |c|
+          c.first
+          c.put 'a', '2', :current => true
+          c.delete
+        end
+        env.changes_since(0).map { |c| c[2..-1] }.should == [[:put, 'other', 'a', '1'],
+                                                             [:put, 'other', 'a', '2'],
+                                                             [:delete, 'other', 'a', '2']]
+      end
+
+      it 'should truncate changes' do
+        db['a'] = '1'
+        db['b'] = '2'
+        first = env.changes_since(0).first[0]
+        env.truncate_changes(first)
+        env.changes_since(0).map { |c| c[4] }.should == ['b']
+      end
+
+      it 'should be disabled by default' do
+        LMDB.new(mkpath('plain')) do |plain|
+          proc { plain.changes_since(0).to_a }.should raise_error(LMDB::Error)
+        end
+      end
+    end
+
+    it 'should wait for commits' do
+      last = env.info[:last_txnid]
+      env.wait_for_commit(last, :timeout => 0.05).should be_nil
+
+      writer = Thread.new do
+        sleep 0.05
+        db['key'] = 'value'
+      end
+      env.wait_for_commit(last, :timeout => 5).should == last + 1
+      writer.join
+      env.wait_for_commit(last).should == last + 1
+    end
+
+    it 'should interrupt a wait for commits' do
+      last = env.info[:last_txnid]
+      waiter = Thread.new { env.wait_for_commit(last) }
+      sleep 0.05
+      started = Time.now
+      waiter.raise(Interrupt)
+      proc { waiter.join }.should raise_error(Interrupt)
+      (Time.now - started).should < 0.05
+    end
+
     it 'should accept custom flags' do
       subject.flags.should_not include(:nosync)
 
@@ -138,6 +574,36 @@ describe LMDB do
         subject.active_txn.should == nil
       end
 
+      it 'should report commit stats' do
+        txn = nil
+        env.transaction do |t|
+          txn = t
+          db['key'] = 'value'
+          t.commit_stats.should be_nil
+        end
+        stats = txn.commit_stats
+        [:prepare, :freelist, :write, :sync, :meta, :total].each do |phase|
+          stats[phase].should be_instance_of(Float)
+        end
+        stats[:total].should >= stats[:write] + stats[:sync] + stats[:meta]
+
+        env.transaction { |t| txn = t; t.abort }
+        txn.commit_stats.should be_nil
+      end
+
+      it 'should report the total commit time of child transactions' do
+        child = nil
+        env.transaction do
+          env.transaction do |t|
+            child = t
+            2000.times { |i| db["child#{i}"] = 'x' * 100 }
+          end
+        end
+        stats = child.commit_stats
+        stats[:total].should > 0
+        stats[:write].should == 0
+      end
+
       it 'should support aborting parent transaction' do
         subject.active_txn.should == nil
         env.transaction do |txn|
@@ -256,6 +722,56 @@ describe LMDB do
       db.stat.should be_instance_of(Hash)
     end
 
+    it 'should return a page report' do
+      env.transaction do
+        2000.times { |i| db['%05d' % i] = 'x' * 100 }
+        db['big'] = 'x' * 10000
+      end
+      report = db.page_report
+      stat = db.stat
+      report[:levels].size.should == stat[:depth]
+      report[:levels].map { |l| l[:pages] }.inject(:+).should == stat[:branch_pages] + stat[:leaf_pages]
+      report[:leaf_pages].should == stat[:leaf_pages]
+      report[:levels].last[:fill].should be_within(0.5).of(0.5)
+      report[:key_sizes].should == {4 => 1, 8 => 2000}
+      report[:value_sizes].should == {128 => 2000, 16384 => 1}
+      report[:overflow_pages].should == {16384 => stat[:overflow_pages]}
+      report[:sequential_leaves].should <= report[:leaf_pages]
+      report.should_not include(:dupsort)
+
+      dupdb = env.transaction { env.database('dupreport', :create => true, :dupsort => true) }
+      env.transaction do
+        dupdb['few'] = 'a'
+        dupdb['few'] = 'b'
+        1000.times { |i| dupdb['many'] = '%05d' % i }
+      end
+      dups = dupdb.page_report[:dupsort]
+      dups[:inline].should == 1
+      dups[:subdbs].should == 1
+      dups[:subdb_pages].should > 1
+      dups[:max_values].should == 1000
+      dups[:value_counts].should == {2 => 1, 1024 => 1}
+      # A named database is an item of the main database, not a sub-DB
+      db.page_report[:value_sizes].values.inject(:+).should == 2002
+    end
+
+    it 'should report residency' do
+      env.transaction do
+        500.times { |i| db['%05d' % i] = 'x' * 100 }
+        db['big'] = 'x' * 10000
+      end
+      stat = db.stat
+      residency = db.residency
+      residency[:branch][:pages].should == stat[:branch_pages]
+      residency[:leaf][:pages].should == stat[:leaf_pages]
+      residency[:overflow][:pages].should == stat[:overflow_pages]
+      residency[:leaf][:resident].should <= residency[:leaf][:pages]
+
+      total = env.residency
+      total[:pages].should == env.info[:last_pgno] + 1
+      total[:resident].should > 0
+    end
+
     it 'should return size' do
       db.size.should == 0
       db.put('key', 'value')
@@ -329,6 +845,53 @@ describe LMDB do
       end
     end
 
+    it 'should read ahead with a sequential hint' do
+      env.transaction do
+        1000.times { |i| db['k%04d' % i] = 'x' * 100 }
+        db['big'] = 'x' * 10000
+      end
+      env.advise(:random)
+      count = 0
+      db.cursor(hint: :sequential) do |c|
+        count += 1 while c.next
+      end
+      count.should == 1003
+      db.each(readahead: true).to_a.should == db.to_a
+      env.advise(:normal)
+      proc { db.cursor(hint: :backwards) {} }.should raise_error(ArgumentError)
+      proc { env.advise(:often) }.should raise_error(ArgumentError)
+    end
+
+    it 'should prefetch leaves across branch pages' do
+      LMDB.new(mkpath('prefetch'), :mapsize => 1 << 26) do |penv|
+        pdb = penv.database
+        keys = (0...20000).map { |i| 'p%05d' % i }
+        penv.transaction { keys.each { |k| pdb[k] = 'x' * 100 } }
+        pdb.stat[:branch_pages].should > 2
+        pdb.cursor(hint: :sequential) do |c|
+          scanned = []
+          while (r = c.next)
+            scanned << r.first
+          end
+          scanned.should == keys
+          # Jumping back restarts the read ahead window of the parent page
+          c.set_range(keys[5000]).first.should == keys[5000]
+          1000.times { |i| c.next.first.should == keys[5001 + i] }
+        end
+        # Dirty leaves of a write transaction are not in the map
+        penv.transaction do
+          pdb[keys[100]] = 'y'
+          scanned = []
+          pdb.cursor do |c|
+            while (r = c.next)
+              scanned << r.first
+            end
+          end
+          scanned.should == keys
+        end
+      end
+    end
+
     it 'should seek to closest key' do
       db.cursor do |c|
         c.set_range('key0').should == ['key1', 'value1']
@@ -403,4 +966,50 @@ describe LMDB do
       db2.should == db
     end
   end
+
+  # Exact numbers of Ruby objects allocated on the hot paths. When one of
+  # these changes, update it deliberately.
+  describe 'allocations' do
+    let(:key) { 'key' }
+    let(:value) { 'value' }
+    let(:missing) { 'missing' }
+
+    before do
+      db.put(key, value)
+      db.put('key2', value)
+    end
+
+    it 'should allocate only the value on get' do
+      env.transaction(true) do
+        allocations { db.get(key) }.should == 1
+        allocations { db.get(missing) }.should == 0
+      end
+    end
+
+    it 'should not allocate on put' do
+      env.transaction do
+        allocations { db.put(key, value) }.should == 0
+      end
+    end
+
+    it 'should allocate the pair on cursor moves' do
+      env.transaction(true) do
+        db.cursor do |c|
+          allocations { c.first }.should == 3
+          allocations { c.first; c.next }.should == 6
+        end
+      end
+    end
+
+    it 'should allocate per transaction and cursor block' do
+      allocations { env.transaction(true) {} }.should == 2
+      allocations { env.transaction {} }.should == 2
+      allocations { env.transaction(true) { db.cursor {} } }.should == 3
+    end
+
+    it 'should allocate per implicit transaction' do
+      allocations { db.get(key) }.should == 3
+      allocations { db.put(key, value) }.should == 2
+    end
+  end
 end